@@ -365,3 +365,131 @@ string Cmd::setCtrlMode(const CtrllMode& mode) {
     return msg.str();
 }
 
+string Cmd::getResetMode() {
+    return "RQ" + DELIM_SP;
+}
+
+string Cmd::setResetMode(const ResetMode& mode) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    msg << "R";
+
+    if (mode == RESET_NONE) {
+        msg << "D";
+    } else if (mode == RESET_PAN_ONLY) {
+        msg << "P";
+    } else if (mode == RESET_TILT_ONLY) {
+        msg << "T";
+    } else if (mode == RESET_BOTH) {
+        msg << "E";
+    } else {
+        throw std::runtime_error(currName + ": invalid reset mode");
+    }
+
+    msg << DELIM_SP;
+    return msg.str();
+}
+
+string Cmd::reset() {
+    return "R" + DELIM_SP;
+}
+
+string Cmd::getHoldPower(const Axis& axis) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    appendAxis(axis, currName, msg);
+
+    msg << "H" << DELIM_SP;
+    return msg.str();
+}
+
+string Cmd::setHoldPower(const PowerLevel& level, const Axis& axis) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    appendAxis(axis, currName, msg);
+    msg << "H";
+
+    if (level == POWER_OFF) {
+        msg << "O";
+    } else if (level == POWER_LOW) {
+        msg << "L";
+    } else if (level == POWER_REGULAR) {
+        msg << "R";
+    } else {
+        throw std::runtime_error(currName + ": invalid hold power level");
+    }
+
+    msg << DELIM_SP;
+    return msg.str();
+}
+
+string Cmd::getMovePower(const Axis& axis) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    appendAxis(axis, currName, msg);
+
+    msg << "M" << DELIM_SP;
+    return msg.str();
+}
+
+string Cmd::setMovePower(const PowerLevel& level, const Axis& axis) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    appendAxis(axis, currName, msg);
+    msg << "M";
+
+    if (level == POWER_LOW) {
+        msg << "L";
+    } else if (level == POWER_REGULAR) {
+        msg << "R";
+    } else if (level == POWER_HIGH) {
+        msg << "H";
+    } else {
+        throw std::runtime_error(currName + ": invalid move power level");
+    }
+
+    msg << DELIM_SP;
+    return msg.str();
+}
+
+string Cmd::getStepMode(const Axis& axis) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    msg << "W";
+    appendAxis(axis, currName, msg);
+
+    msg << DELIM_SP;
+    return msg.str();
+}
+
+string Cmd::setStepMode(const StepMode& mode, const Axis& axis) {
+    string currName = string(BOOST_CURRENT_FUNCTION);
+
+    stringstream msg;
+    msg << "W";
+    appendAxis(axis, currName, msg);
+
+    if (mode == STEP_FULL) {
+        msg << "F";
+    } else if (mode == STEP_HALF) {
+        msg << "H";
+    } else if (mode == STEP_QUARTER) {
+        msg << "Q";
+    } else if (mode == STEP_EIGHTH) {
+        msg << "E";
+    } else if (mode == STEP_AUTO) {
+        msg << "A";
+    } else {
+        throw std::runtime_error(currName + ": invalid step mode");
+    }
+
+    msg << DELIM_SP;
+    return msg.str();
+}
+
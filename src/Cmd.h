@@ -48,6 +48,29 @@ enum CtrllMode {
     INDEP, PURE
 };
 
+/**
+ * The axes reset (homed) when the unit powers up.
+ */
+enum ResetMode {
+    RESET_NONE, RESET_PAN_ONLY, RESET_TILT_ONLY, RESET_BOTH
+};
+
+/**
+ * Motor current levels. Hold power is OFF, LOW or REGULAR, move power is
+ * LOW, REGULAR or HIGH.
+ */
+enum PowerLevel {
+    POWER_OFF, POWER_LOW, POWER_REGULAR, POWER_HIGH
+};
+
+/**
+ * The stepping modes of an axis, from coarse and fast to fine and slow.
+ * In automatic mode the unit picks the mode from the speed.
+ */
+enum StepMode {
+    STEP_FULL, STEP_HALF, STEP_QUARTER, STEP_EIGHTH, STEP_AUTO
+};
+
 class Cmd {
 private:
     /**
@@ -289,6 +312,71 @@ public:
      * Set the current speed control mode (independent or pure speed)
      */
     static std::string setCtrlMode(const CtrllMode& mode);
+
+    /**
+     * Query the reset mode at power up.
+     * @return the properly formated message
+     */
+    static std::string getResetMode();
+
+    /**
+     * Set the axes reset at power up. The setting takes effect at the next
+     * power up.
+     * @return the properly formated message
+     */
+    static std::string setResetMode(const ResetMode& mode);
+
+    /**
+     * Reset the unit now: the axes selected by the reset mode are homed,
+     * which takes several seconds per axis before the unit replies.
+     * @return the properly formated message
+     */
+    static std::string reset();
+
+    /**
+     * Get the power level of an axis while it stands still.
+     * @param axis the axis to be used
+     * @return the properly formated message
+     */
+    static std::string getHoldPower(const Axis& axis);
+
+    /**
+     * Set the power level of an axis while it stands still (off, low or regular).
+     * @param level the power level
+     * @param axis the axis to be used
+     * @return the properly formated message
+     */
+    static std::string setHoldPower(const PowerLevel& level, const Axis& axis);
+
+    /**
+     * Get the power level of an axis while it moves.
+     * @param axis the axis to be used
+     * @return the properly formated message
+     */
+    static std::string getMovePower(const Axis& axis);
+
+    /**
+     * Set the power level of an axis while it moves (low, regular or high).
+     * @param level the power level
+     * @param axis the axis to be used
+     * @return the properly formated message
+     */
+    static std::string setMovePower(const PowerLevel& level, const Axis& axis);
+
+    /**
+     * Get the step mode of an axis.
+     * @param axis the axis to be used
+     * @return the properly formated message
+     */
+    static std::string getStepMode(const Axis& axis);
+
+    /**
+     * Set the step mode of an axis.
+     * @param mode the step mode
+     * @param axis the axis to be used
+     * @return the properly formated message
+     */
+    static std::string setStepMode(const StepMode& mode, const Axis& axis);
 };
 
 } /* namespace ptu */
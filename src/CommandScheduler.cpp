@@ -0,0 +1,333 @@
+/**
+  * Priority scheduling of the commands sent to the Pan-Tilt Unit.
+  * @file CommandScheduler.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "CommandScheduler.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// Static members initialization
+//==============================================================================
+const size_t CommandScheduler::MAX_COMMAND_SIZE = 10;
+const size_t CommandScheduler::MAX_REPLY_SIZE   = 10;
+
+CommandScheduler::Request CommandScheduler::CLOSED;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+void CommandScheduler::ioLoop() {
+    while (true) {
+        drainInbox();
+
+        Request* request = 0;
+        for (int lane = 0; lane < LANE_COUNT && request == 0; ++lane) {
+            if (!mLanes[lane].empty()) {
+                request = mLanes[lane].front();
+                mLanes[lane].pop_front();
+            }
+        }
+
+        if (request == 0) {
+            if (mStop.load() && mInbox.load() == 0) {
+                return;
+            }
+
+            base::Time wait;
+            if (runQuery(wait)) {
+                continue;
+            }
+
+            waitWakeup(wait);
+            continue;
+        }
+
+        try {
+            if (request->batch != 0) {
+                *request->replies = mDriver.exchange(*request->batch);
+            } else {
+                base::Time timeout = request->timeout.isNull()
+                        ? mDriver.getQueryDeadline(request->command.size()) : request->timeout;
+                request->reply = mDriver.exchange(request->command, timeout);
+            }
+        } catch (const DeadlineError& e) {
+            request->error = e.what();
+            request->late = e.getCommand();
+            request->timeout = e.getDeadline();
+        } catch (const std::exception& e) {
+            request->error = e.what();
+        }
+
+        QueryScheduler* queries = mQueries.load();
+        if (queries != 0 && request->lane <= MOTION_LANE) {
+            queries->notifyMotion(base::Time::now());
+        }
+
+        sem_post(&request->done);
+    }
+}
+
+bool CommandScheduler::runQuery(base::Time& wait) {
+    QueryScheduler* queries = mQueries.load();
+    if (queries == 0) {
+        wait = base::Time();
+        return false;
+    }
+
+    string command;
+    int id = queries->next(base::Time::now(), command, wait);
+    if (id < 0) {
+        return false;
+    }
+
+    string reply;
+    try {
+        reply = mDriver.exchange(command, mDriver.getQueryDeadline(command.size()));
+    } catch (const std::exception& e) {
+        LOG_WARN_S << "CommandScheduler: periodic query " << command << " failed: " << e.what();
+    }
+
+    // a throwing listener must not take the I/O thread down
+    try {
+        queries->deliver(id, reply, base::Time::now());
+    } catch (const std::exception& e) {
+        LOG_ERROR_S << "CommandScheduler: listener of periodic query " << command << " failed: " << e.what();
+    } catch (...) {
+        LOG_ERROR_S << "CommandScheduler: listener of periodic query " << command << " failed";
+    }
+    return true;
+}
+
+void CommandScheduler::waitWakeup(const base::Time& timeout) {
+    if (timeout.isNull()) {
+        while (sem_wait(&mWakeup) != 0 && errno == EINTR) {
+        }
+        return;
+    }
+
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    int64_t ns = deadline.tv_nsec + (timeout.toMicroseconds() % 1000000) * 1000;
+    deadline.tv_sec += timeout.toMicroseconds() / 1000000 + ns / 1000000000;
+    deadline.tv_nsec = ns % 1000000000;
+
+    while (sem_timedwait(&mWakeup, &deadline) != 0 && errno == EINTR) {
+    }
+}
+
+void CommandScheduler::drainInbox(bool close) {
+    Request* request = mInbox.exchange(close ? &CLOSED : 0, boost::memory_order_acquire);
+
+    // the inbox is a LIFO, reverse it to restore the submission order
+    Request* fifo = 0;
+    while (request != 0) {
+        Request* next = request->next;
+        request->next = fifo;
+        fifo = request;
+        request = next;
+    }
+
+    for (; fifo != 0; fifo = fifo->next) {
+        mLanes[fifo->lane].push_back(fifo);
+    }
+}
+
+void CommandScheduler::post(Request& request) {
+    if (sem_init(&request.done, 0, 0) != 0) {
+        throw std::runtime_error("CommandScheduler: cannot create semaphore");
+    }
+
+    // checked in the same atomic step as the push, so that no request can
+    // slip in after the final drain of the destructor
+    Request* head = mInbox.load(boost::memory_order_relaxed);
+    do {
+        if (head == &CLOSED) {
+            sem_destroy(&request.done);
+            throw std::runtime_error("CommandScheduler: submit while stopping");
+        }
+        request.next = head;
+    } while (!mInbox.compare_exchange_weak(head, &request, boost::memory_order_release,
+                                           boost::memory_order_relaxed));
+    sem_post(&mWakeup);
+
+    while (sem_wait(&request.done) != 0 && errno == EINTR) {
+    }
+    sem_destroy(&request.done);
+
+    if (!request.late.empty()) {
+        throw DeadlineError(request.late, request.timeout);
+    }
+    if (!request.error.empty()) {
+        throw std::runtime_error(request.error);
+    }
+}
+
+void CommandScheduler::fail(Request* request, const string& error) {
+    request->error = error;
+    sem_post(&request->done);
+}
+
+bool CommandScheduler::awaitPosition(const bool axes[2], const PanTiltTicks& target, unsigned halts,
+                                     const base::Time& timeout) {
+    base::Time deadline = base::Time::now() + timeout;
+
+    while (true) {
+        bool arrived = true;
+
+        for (int i = 0; i < 2 && arrived; ++i) {
+            if (!axes[i]) {
+                continue;
+            }
+
+            if (mHaltCount.load() != halts) {
+                return false;
+            }
+
+            Axis axis = i == 0 ? PAN : TILT;
+            int pos = mDriver.getQuery<int>(submit(Cmd::getPos(axis), MOTION_LANE));
+            int diff = pos - (axis == PAN ? target.pan : target.tilt);
+
+            int modulus = axis == PAN ? mPanModulus.load() : 0;
+            arrived = modulus != 0 ? diff % modulus == 0 : diff == 0;
+        }
+
+        if (arrived) {
+            return true;
+        }
+
+        if (mHaltCount.load() != halts) {
+            return false;
+        }
+
+        if (!timeout.isNull() && base::Time::now() > deadline) {
+            throw DeadlineError(Cmd::awaitPosCmdCompletion(), timeout);
+        }
+
+        boost::this_thread::sleep(boost::posix_time::microseconds(mPollPeriod.toMicroseconds()));
+    }
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+CommandScheduler::CommandScheduler(Driver& driver, int baudrate) :
+        mDriver(driver),
+        mInbox(0),
+        mStop(false),
+        mHaltCount(0),
+        mQueries(0),
+        mPanModulus(0),
+        mPollPeriod(base::Time::fromMilliseconds(20)),
+        mUnitLatency(base::Time::fromMilliseconds(5)),
+        mBaudrate(baudrate)
+{
+    if (sem_init(&mWakeup, 0, 0) != 0) {
+        throw std::runtime_error("CommandScheduler: cannot create semaphore");
+    }
+
+    mThread = boost::thread(&CommandScheduler::ioLoop, this);
+}
+
+CommandScheduler::~CommandScheduler() {
+    stop();
+    sem_destroy(&mWakeup);
+}
+
+void CommandScheduler::stop() {
+    boost::mutex::scoped_lock lock(mStopMutex);
+    if (!mThread.joinable()) {
+        return;
+    }
+
+    mStop.store(true);
+    sem_post(&mWakeup);
+    mThread.join();
+
+    // requests that raced with the shutdown; later ones are rejected
+    drainInbox(true);
+    for (int lane = 0; lane < LANE_COUNT; ++lane) {
+        for (size_t i = 0; i < mLanes[lane].size(); ++i) {
+            fail(mLanes[lane][i], "CommandScheduler: stopped before sending the command");
+        }
+        mLanes[lane].clear();
+    }
+}
+
+string CommandScheduler::submit(const string& command, Lane lane, const base::Time& timeout) {
+    Request request;
+    request.command = command;
+    request.timeout = timeout;
+    request.batch = 0;
+    request.replies = 0;
+    request.lane = lane;
+
+    post(request);
+    return request.reply;
+}
+
+vector<string> CommandScheduler::submitBatch(const vector<string>& commands, Lane lane) {
+    vector<string> replies;
+
+    Request request;
+    request.batch = &commands;
+    request.replies = &replies;
+    request.lane = lane;
+
+    post(request);
+    return replies;
+}
+
+void CommandScheduler::setQueryScheduler(QueryScheduler* queries) {
+    QueryScheduler* previous = mQueries.exchange(queries);
+    sem_post(&mWakeup);
+
+    if (previous == 0 || mStop.load()) {
+        return;
+    }
+
+    // an empty batch completes once the query in flight, if any, is delivered
+    submitBatch(vector<string>(), BACKGROUND_LANE);
+}
+
+void CommandScheduler::halt() {
+    mHaltCount.fetch_add(1);
+    submit(Cmd::haltPosCmd(true, true), EMERGENCY_LANE);
+}
+
+bool CommandScheduler::awaitPosition(const Axis& axis, int target, unsigned halts,
+                                     const base::Time& timeout) {
+    bool axes[2] = { axis == PAN, axis == TILT };
+    return awaitPosition(axes, PanTiltTicks(target, target), halts, timeout);
+}
+
+bool CommandScheduler::awaitPosition(const PanTiltTicks& target, unsigned halts,
+                                     const base::Time& timeout) {
+    bool axes[2] = { true, true };
+    return awaitPosition(axes, target, halts, timeout);
+}
+
+base::Time CommandScheduler::getHaltLatencyBound() const {
+    int64_t wireUs = int64_t(MAX_COMMAND_SIZE + MAX_REPLY_SIZE) * 10 * 1000000 / mBaudrate;
+    return base::Time::fromMicroseconds(2 * (wireUs + mUnitLatency.toMicroseconds()));
+}
+
+base::Time CommandScheduler::getHaltLatencyWorstCase() const {
+    int64_t wireUs = int64_t(MAX_COMMAND_SIZE + MAX_REPLY_SIZE) * 10 * 1000000 / mBaudrate;
+
+    // the lost reply, then resync(1) reads up to two replies with its deadline
+    int64_t lostUs = mDriver.getQueryDeadline(MAX_COMMAND_SIZE).toMicroseconds();
+    int64_t resyncUs = 2 * mDriver.getQueryDeadline(Cmd::getPos(PAN).size(), 2).toMicroseconds();
+
+    return base::Time::fromMicroseconds(lostUs + resyncUs + wireUs + mUnitLatency.toMicroseconds());
+}
@@ -0,0 +1,248 @@
+/**
+  * Priority scheduling of the commands sent to the Pan-Tilt Unit.
+  * @file CommandScheduler.h
+  */
+
+#ifndef COMMAND_SCHEDULER_H_
+#define COMMAND_SCHEDULER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <semaphore.h>
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <base/Time.hpp>
+
+#include "QueryScheduler.h"
+#include "Units.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+class Driver;
+
+/**
+ * The command lanes, from highest to lowest priority.
+ */
+enum Lane {
+    EMERGENCY_LANE,     //!< halts, always sent next
+    MOTION_LANE,        //!< position and speed commands
+    QUERY_LANE,         //!< queries issued by the application
+    BACKGROUND_LANE,    //!< housekeeping, only sent when nothing else waits
+    LANE_COUNT
+};
+
+/**
+ * Serializes all traffic with the unit through one I/O thread and sends the
+ * queued commands lane by lane, highest priority first.
+ *
+ * Any number of threads may submit commands concurrently. Submitting is a
+ * lock-free push onto an inbox list plus a semaphore post; only the I/O
+ * thread sorts the inbox into the lanes and touches the device, and each
+ * caller sleeps on its own request until its reply is in, so replies can not
+ * get mixed up between callers.
+ *
+ * Only one command is on the wire at a time and no command blocks the unit
+ * for longer than one short exchange: with the scheduler running, awaiting
+ * move completion is done by polling the position (see awaitPosition)
+ * instead of the unit's blocking await command. A halt therefore waits for
+ * the exchange in flight plus its own, which getHaltLatencyBound()
+ * quantifies from the baud rate as long as the unit answers. A lost reply
+ * makes the halt wait for that exchange's deadline and the resynchronization
+ * after it. Batches (see submitBatch) occupy the wire as one long exchange,
+ * so keep them short, and Driver::reset holds the wire until the unit
+ * finished homing.
+ */
+class CommandScheduler {
+public:
+    /** Longest command the driver sends (e.g. "PP-123456 "), in bytes. */
+    static const size_t MAX_COMMAND_SIZE;
+    /** Longest reply the driver expects (e.g. "* -123456\r"), in bytes. */
+    static const size_t MAX_REPLY_SIZE;
+
+private:
+    struct Request {
+        std::string command;
+        std::string reply;
+        const std::vector<std::string>* batch;  //!< sent instead of command, if not 0
+        std::vector<std::string>* replies;      //!< the replies to batch
+        std::string error;
+        std::string late;   //!< the command whose reply missed timeout, if any
+        base::Time timeout; //!< deadline of the reply, null for the driver's default
+        Lane lane;
+        Request* next;      //!< next request in the inbox
+        sem_t done;         //!< posted by the I/O thread once replied
+    };
+
+    /** Ends the inbox of a stopped scheduler, which takes no more requests. */
+    static Request CLOSED;
+
+    Driver& mDriver;
+
+    boost::atomic<Request*> mInbox;         //!< lock-free LIFO of submitted requests
+    sem_t mWakeup;                          //!< posted once per submitted request
+    std::deque<Request*> mLanes[LANE_COUNT];    //!< only used by the I/O thread
+    boost::atomic<bool> mStop;
+    boost::mutex mStopMutex;                //!< serializes stop()
+
+    boost::atomic<unsigned> mHaltCount;     //!< incremented by every halt
+    boost::atomic<QueryScheduler*> mQueries;    //!< periodic queries run in idle time, may be 0
+    boost::atomic<int> mPanModulus;         //!< pan positions compare modulo this, if non-zero
+    base::Time mPollPeriod;
+    base::Time mUnitLatency;
+    int mBaudrate;
+
+    boost::thread mThread;
+
+    void ioLoop();
+
+    /**
+     * Sends the most overdue periodic query, if any is due.
+     * @param wait set to the time until the next one is due, null if none
+     */
+    bool runQuery(base::Time& wait);
+
+    /** Sleeps until a request is submitted, at most \p timeout unless null. */
+    void waitWakeup(const base::Time& timeout);
+
+    /**
+     * Moves the inbox into the lanes, keeping the submission order.
+     * @param close whether to close the inbox, so that submit() fails
+     */
+    void drainInbox(bool close = false);
+
+    /** Queues \p request and waits until the I/O thread completed it. */
+    void post(Request& request);
+
+    /** Completes \p request with \p error without sending it. */
+    static void fail(Request* request, const std::string& error);
+
+    /** Polls the axes flagged in \p axes until they reach \p target. */
+    bool awaitPosition(const bool axes[2], const PanTiltTicks& target, unsigned halts,
+                       const base::Time& timeout);
+
+    // non-copyable
+    CommandScheduler(const CommandScheduler&);
+    CommandScheduler& operator=(const CommandScheduler&);
+
+public:
+    /**
+     * Starts the I/O thread. From then on, \p driver must only be accessed
+     * through this scheduler.
+     * @param baudrate the baud rate of the link, for the latency bound
+     */
+    CommandScheduler(Driver& driver, int baudrate);
+
+    /** Stops the I/O thread once the queued commands are sent. */
+    ~CommandScheduler();
+
+    /**
+     * Stops the I/O thread once the queued commands are sent and rejects
+     * all later submissions. Returns once the thread is gone.
+     */
+    void stop();
+
+    /**
+     * Queues \p command in \p lane and waits for its reply, which the unit
+     * must send within \p timeout of the command being written (by default
+     * the driver's query deadline). Time spent queued does not count.
+     * @return the reply of the unit
+     * @throws DeadlineError if the reply did not arrive in time
+     * @throws std::runtime_error if the exchange failed otherwise
+     */
+    std::string submit(const std::string& command, Lane lane,
+                       const base::Time& timeout = base::Time());
+
+    /**
+     * Queues \p commands in \p lane as one batch: they are written at once
+     * and no other command is sent until all replies are in.
+     * @return the replies, one per command
+     * @throws std::runtime_error if any exchange failed (see Driver::exchange)
+     */
+    std::vector<std::string> submitBatch(const std::vector<std::string>& commands, Lane lane);
+
+    /**
+     * Halts both axes. The halt overtakes every queued command and preempts
+     * running awaitPosition() calls.
+     */
+    void halt();
+
+    /** Number of halts so far; a change tells a caller that a halt happened. */
+    unsigned getHaltCount() const { return mHaltCount.load(); }
+
+    /**
+     * Polls the position of \p axis until it reaches \p target.
+     * @param halts getHaltCount() read before the move was sent, so that a
+     *        halt between sending and awaiting is not missed
+     * @param timeout longest time to wait, unbounded if null
+     * @return false if a halt happened since \p halts
+     * @throws DeadlineError if the axis did not arrive within \p timeout
+     */
+    bool awaitPosition(const Axis& axis, int target, unsigned halts,
+                       const base::Time& timeout = base::Time());
+
+    /**
+     * Polls the position of both axes until they reach \p target.
+     * @param halts getHaltCount() read before the move was sent
+     * @param timeout longest time to wait, unbounded if null
+     * @return false if a halt happened since \p halts
+     * @throws DeadlineError if the axes did not arrive within \p timeout
+     */
+    bool awaitPosition(const PanTiltTicks& target, unsigned halts,
+                       const base::Time& timeout = base::Time());
+
+    /**
+     * Runs the queries of \p queries whenever no lane has a command waiting.
+     * Motion and emergency commands are reported to it. 0 stops them.
+     * Returns once the previous query scheduler is no longer in use, so it
+     * may be destroyed right after.
+     */
+    void setQueryScheduler(QueryScheduler* queries);
+
+    /**
+     * Makes awaitPosition compare pan positions modulo \p ticks, for units
+     * in continuous pan mode whose position may wrap. 0 disables it.
+     */
+    void setPanModulus(int ticks) { mPanModulus.store(ticks); }
+
+    /** Period at which awaitPosition polls, 20ms by default. */
+    void setPollPeriod(const base::Time& period) { mPollPeriod = period; }
+
+    /**
+     * Worst-case time the unit needs to answer a command once received,
+     * 5ms by default.
+     */
+    void setUnitLatency(const base::Time& latency) { mUnitLatency = latency; }
+
+    /**
+     * Best-case bound on the time between a call to halt() and its
+     * acknowledgement by the unit: the exchange currently in flight plus the
+     * halt exchange itself, each at most MAX_COMMAND_SIZE + MAX_REPLY_SIZE
+     * bytes of 10 bits plus the unit latency.
+     *
+     * It holds only while the unit answers every command and a single
+     * command is in flight; see getHaltLatencyWorstCase() for a lost reply.
+     */
+    base::Time getHaltLatencyBound() const;
+
+    /**
+     * Bound on the halt latency when the reply in flight is lost: the query
+     * deadline of that exchange, the resynchronization after it (see
+     * Driver::getQueryDeadline) and the halt exchange. It assumes the
+     * command in flight has the default query deadline; batches and
+     * Driver::reset are not covered.
+     */
+    base::Time getHaltLatencyWorstCase() const;
+};
+
+} /* namespace ptu */
+
+#endif /* COMMAND_SCHEDULER_H_ */
@@ -8,9 +8,15 @@
 // Includes
 //==============================================================================
 #include "Driver.h"
+#include "RecordingStream.h"
 using namespace ptu;
 
+#include <iodrivers_base/Exceptions.hpp>
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 #include <cmath>
@@ -30,45 +36,489 @@ const float ptu::Driver::DEGREEPERSECARC = 0.0002778;
 //==============================================================================
 
 
-void Driver::initialize() {   
+DeadlineError::DeadlineError(const std::string& command, const base::Time& deadline) :
+        iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::PACKET,
+                "no reply to '" + command.substr(0, command.find_last_not_of(' ') + 1) +
+                "' within " + lexical_cast<std::string>((deadline.toMicroseconds() + 999) / 1000) + " ms"),
+        mCommand(command),
+        mDeadline(deadline)
+{}
+
+StartupOptions::StartupOptions() :
+        setResetMode(false),
+        resetMode(RESET_BOTH),
+        resetPan(false),
+        resetTilt(false),
+        checkPosition(false),
+        tolerance(0),
+        jog(50),
+        resetOnFailure(true)
+{}
+
+void Driver::initialize(const StartupOptions& options) {   
 
 	//set response mode of the device to short (easier parsing) mode.
-	write("FT ");
-        readAns();
+	transact("FT ", QUERY_LANE);
+
+        queryGeometry(PAN);
+        queryGeometry(TILT);
+
+        queryMotionModel();
+
+        if (options.setResetMode)
+            setResetMode(options.resetMode);
+
+        bool reset_axis[2] = { options.resetPan, options.resetTilt };
+
+        for (int i = 0; i < 2 && options.checkPosition; ++i) {
+            if (reset_axis[i])
+                continue;
+
+            Axis axis = i == 0 ? PAN : TILT;
+            int expected = axis == PAN ? options.expected.pan : options.expected.tilt;
+
+            if (checkPosition(axis, expected, options.tolerance, options.jog))
+                continue;
+
+            if (!options.resetOnFailure)
+                throw std::runtime_error(std::string("initialize: position check failed on the ") +
+                                         (axis == PAN ? "pan" : "tilt") + " axis");
+            reset_axis[i] = true;
+        }
+
+        reset(reset_axis[PAN], reset_axis[TILT]);
+}
+
+void Driver::queryGeometry(Axis axis) {
+
+    const char* name = axis == PAN ? "Pan" : "Tilt";
+
+    // the resolution is reported in arc seconds
+    float res = getQuery<float>(transact(Cmd::getResolution(axis), QUERY_LANE));
+    int min_pos = getQuery<int>(transact(Cmd::getMinPos(axis), QUERY_LANE));
+    int max_pos = getQuery<int>(transact(Cmd::getMaxPos(axis), QUERY_LANE));
+
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        mUnits.axis(axis).setResolutionDeg(res * DEGREEPERSECARC);
+        (axis == PAN ? mMinPanRad : mMinTiltRad) = mUnits.axis(axis).ticksToRad(min_pos);
+        (axis == PAN ? mMaxPanRad : mMaxTiltRad) = mUnits.axis(axis).ticksToRad(max_pos);
+        mGuard.setLimits(axis, mUnits.axis(axis).ticksToRad(min_pos), mUnits.axis(axis).ticksToRad(max_pos));
+    }
+
+    LOG_INFO_S << name << " resolution is " << mUnits.axis(axis).getResolutionDeg() << " deg/position";
+
+    LOG_INFO_S << name << " limits (rad): " << (axis == PAN ? mMinPanRad : mMinTiltRad)
+               << " to " << (axis == PAN ? mMaxPanRad : mMaxTiltRad);
+}
+
+ResetMode Driver::getResetMode() {
+
+    std::string reply = transact(Cmd::getResetMode(), QUERY_LANE);
+
+    if (reply.find('D') != std::string::npos)
+        return RESET_NONE;
+    if (reply.find('P') != std::string::npos)
+        return RESET_PAN_ONLY;
+    if (reply.find('T') != std::string::npos)
+        return RESET_TILT_ONLY;
+    return RESET_BOTH;
+}
+
+void Driver::setResetMode(ResetMode mode) {
+
+    transact(Cmd::setResetMode(mode), MOTION_LANE);
+}
+
+void Driver::reset(bool pan, bool tilt, const base::Time& timeout) {
+
+    if (!pan && !tilt)
+        return;
+
+    ResetMode previous = RESET_BOTH;
+    if (!(pan && tilt)) {
+        previous = getResetMode();
+        setResetMode(pan ? RESET_PAN_ONLY : RESET_TILT_ONLY);
+    }
+
+    LOG_INFO_S << "Resetting the " << (pan && tilt ? "pan and tilt axes" : pan ? "pan axis" : "tilt axis");
+
+    try {
+        transact(Cmd::reset(), MOTION_LANE, timeout);
+    } catch (...) {
+        // the original error matters more than a failing restore
+        try {
+            if (!(pan && tilt))
+                setResetMode(previous);
+        } catch (std::exception& e) {
+            LOG_ERROR_S << "reset: cannot restore the reset mode: " << e.what();
+        }
+        // the axes may have started homing
+        forgetPos();
+        {
+            boost::mutex::scoped_lock lock(mStateMutex);
+            mPanTracked = false;
+        }
+        throw;
+    }
+
+    if (!(pan && tilt))
+        setResetMode(previous);
+
+    forgetPos();
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mPanTracked = false;
+}
+
+bool Driver::checkPosition(Axis axis, int expected, int tolerance, int jog) {
+
+    const char* name = axis == PAN ? "pan" : "tilt";
+
+    try {
+        int pos = getPos(axis, false);
+
+        if (std::abs(pos - expected) > tolerance) {
+            LOG_WARN_S << "checkPosition: " << name << " at " << pos << ", expected " << expected;
+            return false;
+        }
+
+        if (jog == 0)
+            return true;
+
+        // jog towards the side with room left
+        float maxRad = axis == PAN ? mMaxPanRad : mMaxTiltRad;
+        int target = pos + jog <= mUnits.axis(axis).radToTicks(maxRad) ? pos + jog : pos - jog;
+
+        if (!jogTo(axis, target) || !jogTo(axis, pos)) {
+            LOG_WARN_S << "checkPosition: " << name << " did not follow the test move";
+            return false;
+        }
+    } catch (const std::runtime_error& e) {
+        LOG_WARN_S << "checkPosition: " << name << " failed: " << e.what();
+        return false;
+    }
+
+    LOG_INFO_S << "checkPosition: " << name << " position is valid";
+    return true;
+}
+
+bool Driver::jogTo(Axis axis, int target) {
+
+    // a known start bounds the await by the move deadline of the jog itself
+    getPos(axis, false);
+
+    try {
+        return setPos(axis, false, target, true);
+    } catch (const DeadlineError& e) {
+        LOG_WARN_S << "jogTo: " << e.what();
+        return false;
+    }
+}
+
+MotionModel Driver::getMotionModel() const {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    return mMotion;
+}
+
+MotionModel Driver::queryMotionModel() {
+
+    MotionModel model;
+
+    for (int i = 0; i < 2; ++i) {
+        Axis axis = i == 0 ? PAN : TILT;
+        AxisMotion& motion = model.axis(axis);
+
+        motion.speed = getQuery<int>(transact(Cmd::getDesiredSpeed(axis), QUERY_LANE));
+        motion.accel = getQuery<int>(transact(Cmd::getDesiredAccel(axis), QUERY_LANE));
+        motion.baseSpeed = getQuery<int>(transact(Cmd::getDesiredBaseSpeed(axis), QUERY_LANE));
+    }
+
+    LOG_INFO_S << "Pan speed/accel/base: " << model.axis(PAN).speed << "/" 
+               << model.axis(PAN).accel << "/" << model.axis(PAN).baseSpeed;
+    LOG_INFO_S << "Tilt speed/accel/base: " << model.axis(TILT).speed << "/" 
+               << model.axis(TILT).accel << "/" << model.axis(TILT).baseSpeed;
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mMotion = model;
+    mPredictor.setMotionModel(mMotion);
+    return model;
+}
+
+MotionConfig Driver::getConfig() const {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+
+    MotionConfig config = mConfig;
+    for (int i = 0; i < 2; ++i) {
+        Axis axis = i == 0 ? PAN : TILT;
+        const AxisMotion& motion = mMotion.axis(axis);
+        config.axis(axis).speed = round(motion.speed);
+        config.axis(axis).accel = round(motion.accel);
+        config.axis(axis).baseSpeed = round(motion.baseSpeed);
+    }
+    return config;
+}
+
+MotionConfig Driver::snapshotConfig() {
+
+    MotionConfig config = MotionConfig::parse(transactBatch(MotionConfig::queries(), QUERY_LANE));
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mConfig = config;
+    mConfigKnown = true;
+    mMotion.axis(PAN) = config.pan.motion();
+    mMotion.axis(TILT) = config.tilt.motion();
+    mPredictor.setMotionModel(mMotion);
+    return config;
+}
+
+size_t Driver::applyConfig(const MotionConfig& config) {
+
+    bool known;
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        known = mConfigKnown;
+    }
+    if (!known)
+        snapshotConfig();
+
+    std::vector<std::string> commands = config.commandsFrom(getConfig());
+
+    if (!commands.empty()) {
+        try {
+            transactBatch(commands, MOTION_LANE);
+        } catch (const std::exception&) {
+            // some of the settings may have been taken, read them again next time
+            boost::mutex::scoped_lock lock(mStateMutex);
+            mConfigKnown = false;
+            throw;
+        }
+    }
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mConfig = config;
+    mMotion.axis(PAN) = config.pan.motion();
+    mMotion.axis(TILT) = config.tilt.motion();
+    mPredictor.setMotionModel(mMotion);
+    return commands.size();
+}
+
+void Driver::defineConfig(const std::string& name, const MotionConfig& config) {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mConfigs.set(name, config);
+}
 
-        // get the pan resolution
-        write(Cmd::getResolution(PAN));
-        mPanResolutionDeg = getQuery<float>(readAns()) * DEGREEPERSECARC;
-        LOG_INFO_S << "Pan resolution is " << mPanResolutionDeg << " deg/position";
+size_t Driver::applyConfig(const std::string& name) {
 
-        // get the tilt resolution
-        write(Cmd::getResolution(TILT));
-        mTiltResolutionDeg = getQuery<float>(readAns()) * DEGREEPERSECARC;
-        LOG_INFO_S << "Tilt resolution is " << mTiltResolutionDeg << " deg/position";
+    MotionConfig config;
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        config = mConfigs.get(name);
+    }
+    return applyConfig(config);
+}
+
+
+void Driver::startRecording(const std::string& path) {
+
+    if (getFileDescriptor() < 0)
+        throw std::runtime_error("startRecording: the driver is not connected to a file descriptor");
+
+    stopRecording();
+    mRecording.reset(new TrafficLogWriter(path));
+
+    // the current stream closes its descriptor when replaced
+    int fd = dup(getFileDescriptor());
+    if (fd < 0)
+        throw std::runtime_error("startRecording: cannot duplicate the device descriptor");
+
+    setMainStream(new RecordingStream(fd, mRecording));
+    LOG_INFO_S << "Recording traffic to " << path;
+}
+
+void Driver::stopRecording() {
+
+    // the I/O thread of the scheduler may be recording right now; the writer
+    // serializes that with close, and the RecordingStream keeps its own
+    // reference, so later appends are just ignored
+    if (mRecording) {
+        if (!mRecording->close())
+            LOG_WARN_S << "stopRecording: the end of the traffic log could not be written";
+        mRecording.reset();
+    }
+}
+
+void Driver::openReplay(const std::string& path, ReplayMode mode) {
+
+    stopRecording();
+    setMainStream(new ReplayStream(path, mode));
+    LOG_INFO_S << "Replaying traffic from " << path;
+}
+
+
+void Driver::startScheduler() {
+
+    boost::mutex::scoped_lock lock(mSchedulerMutex);
+    if (!mScheduler) {
+        mScheduler.reset(new CommandScheduler(*this, mBaudrate));
+        mScheduler->setPanModulus(mContinuousPan ? panTicksPerTurn() : 0);
+        mScheduler->setQueryScheduler(mQueries);
+    }
+}
+
+void Driver::setQueryScheduler(QueryScheduler* queries) {
 
-        // get min/max pan in rad
-        write(Cmd::getMinPos(PAN));
-        int min_pan = getQuery<int>(readAns());
+    mQueries = queries;
+    startScheduler();
+    getScheduler()->setQueryScheduler(queries);
+}
+
+void Driver::stopScheduler() {
+
+    boost::shared_ptr<CommandScheduler> scheduler;
+    {
+        boost::mutex::scoped_lock lock(mSchedulerMutex);
+        scheduler.swap(mScheduler);
+    }
+
+    // threads still holding a copy keep it alive, but its I/O thread must be
+    // gone before commands are sent directly again
+    if (scheduler)
+        scheduler->stop();
+}
+
+boost::shared_ptr<CommandScheduler> Driver::getScheduler() const {
+
+    boost::mutex::scoped_lock lock(mSchedulerMutex);
+    return mScheduler;
+}
+
+std::string Driver::transact(const std::string& msg, Lane lane, const base::Time& timeout) {
+
+    base::Time deadline = timeout.isNull() ? getQueryDeadline(msg.size()) : timeout;
 
-        write(Cmd::getMaxPos(PAN));
-        int max_pan = getQuery<int>(readAns());
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    if (scheduler)
+        return scheduler->submit(msg, lane, deadline);
 
-        mMinPanRad = float(min_pan) * mPanResolutionDeg * M_PI / 180.0;
-        mMaxPanRad = float(max_pan) * mPanResolutionDeg * M_PI / 180.0;
+    return exchange(msg, deadline);
+}
+
+std::string Driver::exchange(const std::string& msg, const base::Time& timeout) {
+
+    write(msg);
+    try {
+        return readAns(timeout);
+    } catch (const iodrivers_base::TimeoutError&) {
+        resync(1);
+        throw DeadlineError(msg, timeout);
+    }
+}
 
-        LOG_INFO_S << "Pan limits (rad): " <<  mMinPanRad << " to " << mMaxPanRad;
-	     
-        // get min/max tilt in rad
-        write(Cmd::getMinPos(TILT));
-        int min_tilt = getQuery<int>(readAns());
+void Driver::resync(size_t pending) {
 
-        write(Cmd::getMaxPos(TILT));
-        int max_tilt = getQuery<int>(readAns());
+    // the unit answers in order: once the late replies and the one to a
+    // query of our own are in, the next reply belongs to the next command
+    std::string sync = Cmd::getPos(PAN);
+    write(sync);
 
-        mMinTiltRad = float(min_tilt) * mTiltResolutionDeg * M_PI / 180.0;
-        mMaxTiltRad = float(max_tilt) * mTiltResolutionDeg * M_PI / 180.0;
+    base::Time deadline = getQueryDeadline(sync.size(), pending + 1);
+    size_t received = 0;
+    for (; received <= pending; ++received) {
+        try {
+            readAns(deadline);
+        } catch (const iodrivers_base::TimeoutError&) {
+            // fewer replies than owed, some were lost
+            break;
+        } catch (const std::runtime_error&) {
+            // an error reply is a reply as well
+        }
+    }
+    clear();
 
-        LOG_INFO_S << "Tilt limits (rad): " <<  mMinTiltRad << " to " << mMaxTiltRad;
+    if (received == 0)
+        LOG_WARN_S << "resync: the unit did not answer, a late reply may still desync the link";
+}
+
+base::Time Driver::getQueryDeadline(size_t sentBytes, size_t replies) const {
+
+    // 10 bits per byte with start and stop bit
+    int64_t bytes = sentBytes + replies * CommandScheduler::MAX_REPLY_SIZE;
+    int64_t wireUs = bytes * 10 * 1000000 / mBaudrate;
+
+    return base::Time::fromMicroseconds(wireUs + replies * mUnitLatency.toMicroseconds() +
+                                        mDeadlineMargin.toMicroseconds());
+}
+
+base::Time Driver::getMoveDeadline(double seconds) const {
+
+    return base::Time::fromSeconds(seconds * (1 + mMoveMargin)) +
+           getQueryDeadline(Cmd::awaitPosCmdCompletion().size());
+}
+
+void Driver::setDeadlines(const base::Time& unitLatency, const base::Time& margin) {
+
+    mUnitLatency = unitLatency;
+    mDeadlineMargin = margin;
+}
+
+double Driver::awaitDuration(Axis axis, int from, int target, bool known) const {
+
+    if (!known) {
+        float range = axis == PAN ? mMaxPanRad - mMinPanRad : mMaxTiltRad - mMinTiltRad;
+        from = 0;
+        target = mUnits.axis(axis).radToTicks(range);
+    }
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    return mPredictor.duration(axis, target - from);
+}
+
+std::vector<std::string> Driver::transactBatch(const std::vector<std::string>& msgs, Lane lane) {
+
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    if (scheduler)
+        return scheduler->submitBatch(msgs, lane);
+
+    return exchange(msgs);
+}
+
+std::vector<std::string> Driver::exchange(const std::vector<std::string>& msgs) {
+
+    if (msgs.empty())
+        return std::vector<std::string>();
+
+    std::string batch;
+    for (size_t i = 0; i < msgs.size(); ++i)
+        batch += msgs[i];
+
+    write(batch);
+
+    // the last reply may come after the whole batch was processed
+    base::Time deadline = getQueryDeadline(batch.size(), msgs.size());
+
+    std::vector<std::string> replies;
+    std::string error;
+
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        try {
+            replies.push_back(readAns(deadline));
+        } catch (const iodrivers_base::TimeoutError&) {
+            resync(msgs.size() - i);
+            throw DeadlineError(msgs[i], deadline);
+        } catch (const std::runtime_error& e) {
+            if (error.empty())
+                error = "'" + msgs[i].substr(0, msgs[i].find_last_not_of(' ') + 1) + "' failed: " + e.what();
+            replies.push_back(std::string());
+        }
+    }
+
+    if (!error.empty())
+        throw std::runtime_error(error);
+
+    return replies;
 }
 
 
@@ -80,11 +530,17 @@ void Driver::write(const std::string& msg) {
 
 std::string Driver::readAns() {
 
+    return readAns(getReadTimeout());
+}
+
+
+std::string Driver::readAns(const base::Time& timeout) {
+
     uint8_t buffer[MAX_PACKET_SIZE];
     size_t bufferSize = MAX_PACKET_SIZE;
     size_t packetSize;
 
-    packetSize = readPacket(buffer, bufferSize);
+    packetSize = readPacket(buffer, bufferSize, timeout);
    
     if ( packetSize < 2) 
         throw std::runtime_error("answer must be at least of size 2");
@@ -134,33 +590,175 @@ int Driver::extractPacket(const uint8_t* buffer, size_t size) const {
 
 Driver::Driver() :
         iodrivers_base::Driver(MAX_PACKET_SIZE),
-        mPanResolutionDeg(1.0),
-        mTiltResolutionDeg(1.0)
-{}
+        mUnits(DEGREEPERTICK, DEGREEPERTICK),
+        mConfigKnown(false),
+        mImmediatePosExec(true),
+        mQueries(0),
+        mBaudrate(DEFAULT_BAUDRATE),
+        mSerialTuning(0),
+        mSavedLatencyTimer(-1),
+        mUnitLatency(base::Time::fromMilliseconds(5)),
+        mDeadlineMargin(base::Time::fromMilliseconds(20)),
+        mMoveMargin(0.5),
+        mContinuousPan(false),
+        mPanTracked(false),
+        mLastPanTicks(0),
+        mPanTurnTicks(0)
+{
+    mLastPosKnown[PAN] = mLastPosKnown[TILT] = false;
+}
 
 Driver::~Driver() {
+    stopScheduler();
+    stopRecording();
     if (this->isValid()) {
         this->close();
     }
+    restoreLatencyTimer();
+}
+
+void Driver::restoreLatencyTimer() {
+
+    if (mSavedLatencyTimer < 0)
+        return;
+
+    if (!SerialTuning::restoreLatencyTimer(mSerialPort, mSavedLatencyTimer))
+        LOG_WARN_S << "cannot restore the latency timer of " << mSerialPort << " to "
+                   << mSavedLatencyTimer << " ms";
+    mSavedLatencyTimer = -1;
+}
+
+void Driver::close() {
+
+    iodrivers_base::Driver::close();
+    restoreLatencyTimer();
+    mSerialTuning = 0;
+}
+
+bool Driver::openSerial(std::string const& port, int baudrate) {
+
+    return openSerial(port, baudrate, false);
+}
+
+bool Driver::openSerial(std::string const& port, int baudrate, bool lowLatency) {
+
+    restoreLatencyTimer();
+
+    mBaudrate = baudrate;
+    mSerialTuning = 0;
+    if (!iodrivers_base::Driver::openSerial(port, baudrate))
+        return false;
+
+    if (lowLatency) {
+        mSerialPort = port;
+        mSerialTuning = SerialTuning::apply(getFileDescriptor(), port, &mSavedLatencyTimer);
+        LOG_INFO_S << "openSerial: low latency settings in effect on " << port << ": "
+                   << SerialTuning::describe(mSerialTuning);
+        if (mSerialTuning != SerialTuning::ALL)
+            LOG_WARN_S << "openSerial: not in effect: "
+                       << SerialTuning::describe(SerialTuning::ALL & ~mSerialTuning);
+    }
+    return true;
 }
 
 //TODO check if offset parameter is really usefull here, since PO and PP seem to 
 //     have always the same answer.
 int Driver::getPos(Axis axis, bool offset) {
 
-    write(Cmd::getPos(axis, offset));
+    int pos = getQuery<int>(transact(Cmd::getPos(axis, offset), QUERY_LANE));
+
+    if (axis == PAN && !offset && mContinuousPan)
+        trackPan(pos);
+
+    if (!offset) {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        (axis == PAN ? mLastPos.pan : mLastPos.tilt) = pos;
+        mLastPosKnown[axis == PAN ? PAN : TILT] = true;
+    }
+
+    return pos;
+}
+
+int Driver::panTicksPerTurn() const {
+
+    return mUnits.axis(PAN).degToTicks(360.0);
+}
+
+void Driver::trackPan(int ticks) {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+
+    if (mPanTracked) {
+        // the reading may wrap around, take the shorter way
+        int turn = panTicksPerTurn();
+        long long delta = (long long)(ticks) - mLastPanTicks;
+        delta -= turn * (long long)floor(double(delta) / turn + 0.5);
+        mPanTurnTicks += delta;
+    } else {
+        mPanTurnTicks = ticks;
+        mPanTracked = true;
+    }
+
+    mLastPanTicks = ticks;
+}
+
+int Driver::shortestPanOffset(int target) {
+
+    int turn = panTicksPerTurn();
+    int delta = (target - getPos(PAN, false)) % turn;
 
-    return getQuery<int>(readAns());
+    if (delta > turn / 2)
+        delta -= turn;
+    else if (delta <= -turn / 2)
+        delta += turn;
+
+    return delta;
+}
+
+void Driver::setContinuousPan(bool enable) {
+
+    if (enable && mGuard.getZoneCount() > 0)
+        throw std::runtime_error("setContinuousPan: keep-out zones are not checked in continuous pan mode, "
+                                 "clear them first");
+
+    transact(Cmd::setPanLimitMode(!enable), MOTION_LANE);
+
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        mContinuousPan = enable;
+        mPanTracked = false;
+    }
+
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    if (scheduler)
+        scheduler->setPanModulus(enable ? panTicksPerTurn() : 0);
+
+    if (enable)
+        getPos(PAN, false);
+}
+
+bool Driver::getPanLimitMode() {
+
+    std::string reply = transact(Cmd::getPanLimitMode(), QUERY_LANE);
+    return reply.find('D') == std::string::npos;
+}
+
+double Driver::getPanMultiTurnRad() {
+
+    getPos(PAN, false);
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    return mPanTurnTicks * mUnits.axis(PAN).ticksToRad(1);
 }
 
 float Driver::getPosDeg(Axis axis, bool offset) {
 
-    return float(getPos(axis, offset)) * DEGREEPERTICK;
+    return mUnits.axis(axis).ticksToDeg(getPos(axis, offset));
 }
 
 float Driver::getPosRad(Axis axis, bool offset) {
 
-    return getPosDeg(axis, offset) / 180.0 * M_PI;
+    return mUnits.axis(axis).ticksToRad(getPos(axis, offset));
 }
 
 
@@ -168,65 +766,465 @@ float Driver::getPosRad(Axis axis, bool offset) {
 bool Driver::setPosDeg(const Axis &axis, const bool &offset, const float &val, 
                        const bool &awaitCompletion){
     
-    int ticks = round(val / DEGREEPERTICK);
-    setPos(axis, offset, ticks, awaitCompletion);
-    
-    return true;
+    return setPos(axis, offset, mUnits.axis(axis).degToTicks(val), awaitCompletion);
 }
 bool Driver::setPosRad(const Axis &axis, const bool &offset, const float &val, 
                        const bool &awaitCompletion){
 
-    return setPosDeg(axis, offset, val / M_PI * 180.0, awaitCompletion);
+    return setPos(axis, offset, mUnits.axis(axis).radToTicks(val), awaitCompletion);
 }
 
 
 bool Driver::setPos(const Axis& axis, const bool& offset, const int& val, 
                     const bool& awaitCompletion) {
 
-    write(Cmd::setPos(val, axis, offset));
+    if (axis == PAN && !offset && mContinuousPan)
+        return setPos(axis, true, shortestPanOffset(val), awaitCompletion);
 
-    readAns();
+    int index = axis == PAN ? PAN : TILT;
+    int from;
+    bool known;
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        from = axis == PAN ? mLastPos.pan : mLastPos.tilt;
+        known = mLastPosKnown[index] && !(axis == PAN && mContinuousPan);
+    }
 
-    if (awaitCompletion){
-	
-	//set awaitCompletion mode      
-	LOG_DEBUG_S << "setPos: with await completion.";
-	write(Cmd::awaitPosCmdCompletion());
-	
-	//check if command was set successfully.
-	readAns();
+    // the soft limits and the polled await need an absolute target
+    bool guarded = !(axis == PAN && mContinuousPan);
+    if (offset && !known && (guarded || (awaitCompletion && getScheduler()))) {
+        from = getPos(axis, false);
+        known = true;
     }
+    int target = offset ? from + val : val;
+
+    if (guarded) {
+        mGuard.validate(axis, mUnits.axis(axis).ticksToRad(target));
 
+        // zones need both axes
+        if (mGuard.getZoneCount() > 0 && !mContinuousPan) {
+            Axis other = axis == PAN ? TILT : PAN;
+            int otherPos = getPos(other, false);
+
+            return setPos(axis == PAN ? PanTiltTicks(target, otherPos) : PanTiltTicks(otherPos, target),
+                          awaitCompletion);
+        }
+    }
+
+    // a halt between sending and awaiting must still preempt the await
+    unsigned halts = haltCount();
+    base::Time start = base::Time::now();
+    transact(Cmd::setPos(val, axis, offset), MOTION_LANE);
+
+    if (!awaitCompletion) {
+        forgetPos();
+        return true;
+    }
+
+    bool arrived = true;
+    base::Time deadline = getMoveDeadline(awaitDuration(axis, from, target, known));
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    try {
+        if (scheduler) {
+            // poll instead of the blocking await so that halts can preempt it
+            arrived = scheduler->awaitPosition(axis, target, halts, deadline);
+        } else {
+            //set awaitCompletion mode      
+            LOG_DEBUG_S << "setPos: with await completion.";
+
+            //check if command was set successfully.
+            transact(Cmd::awaitPosCmdCompletion(), MOTION_LANE, deadline);
+        }
+    } catch (DeadlineError&) {
+        // the axes may have started homing
+        forgetPos();
+        {
+            boost::mutex::scoped_lock lock(mStateMutex);
+            mPanTracked = false;
+        }
+        throw;
+    }
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    if (arrived && known)
+        mPredictor.observe(axis, target - from, (base::Time::now() - start).toSeconds());
+
+    (axis == PAN ? mLastPos.pan : mLastPos.tilt) = target;
+    mLastPosKnown[index] = arrived && (known || !offset) && !(axis == PAN && mContinuousPan);
+    return arrived;
+}
+
+bool Driver::setPos(const PanTiltTicks& target, const bool& awaitCompletion) {
+
+    mGuard.validate(mUnits.toRad(target), !mContinuousPan);
+
+    unsigned halts = haltCount();
+    if (mGuard.getZoneCount() == 0 || mContinuousPan)
+        return moveTo(target, awaitCompletion, halts);
+
+    // the remembered position misses moves made by other means (velocity
+    // mode, the console), and the zone check must not start from a guess
+    PanTiltTicks from(getPos(PAN, false), getPos(TILT, false));
+
+    MovePredictor predictor = getPredictor();
+    if (mGuard.isClear(from, target, mUnits, predictor))
+        return moveTo(target, awaitCompletion, halts);
+
+    double duration;
+    std::vector<PanTiltTicks> waypoints = mGuard.route(from, target, mUnits, predictor, &duration);
+    LOG_INFO_S << "setPos: routed around the keep-out zones over " << waypoints.size() - 1
+               << " waypoints, predicted " << duration << " s";
+
+    // a halt anywhere along the route ends it
+    for (size_t i = 0; i + 1 < waypoints.size(); ++i) {
+        if (!moveTo(waypoints[i], true, halts))
+            return false;
+    }
+    return moveTo(target, awaitCompletion, halts);
+}
+
+void Driver::addKeepOutZone(const MotionGuard::Polygon& polygon) {
+
+    if (mContinuousPan)
+        throw std::runtime_error("addKeepOutZone: keep-out zones are not checked in continuous pan mode");
+
+    mGuard.addZone(polygon);
+}
+
+void Driver::clearKeepOutZones() {
+
+    mGuard.clearZones();
+}
+
+void Driver::setKeepOutClearance(double clearance) {
+
+    mGuard.setClearance(clearance);
+}
+
+bool Driver::moveTo(const PanTiltTicks& target, bool awaitCompletion, unsigned halts) {
+
+    if (haltCount() != halts)
+        return false;
+
+    PanTiltTicks from;
+    bool known;
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        from = mLastPos;
+        known = mLastPosKnown[PAN] && mLastPosKnown[TILT] && !mContinuousPan;
+    }
+    base::Time start = base::Time::now();
+
+    // in immediate execution mode both axes start right away; one batch so
+    // that tilt does not start a round trip after pan
+    std::vector<std::string> commands;
+    if (mContinuousPan)
+        commands.push_back(Cmd::setPos(shortestPanOffset(target.pan), PAN, true));
+    else
+        commands.push_back(Cmd::setPos(target.pan, PAN));
+    commands.push_back(Cmd::setPos(target.tilt, TILT));
+    transactBatch(commands, MOTION_LANE);
+
+    if (!awaitCompletion) {
+        forgetPos();
+        return true;
+    }
+
+    bool arrived = true;
+    double seconds = std::max(awaitDuration(PAN, from.pan, target.pan, known),
+                              awaitDuration(TILT, from.tilt, target.tilt, known));
+    try {
+        boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+        if (scheduler)
+            arrived = scheduler->awaitPosition(target, halts, getMoveDeadline(seconds));
+        else
+            transact(Cmd::awaitPosCmdCompletion(), MOTION_LANE, getMoveDeadline(seconds));
+    } catch (DeadlineError&) {
+        // the axes may have started homing
+        forgetPos();
+        {
+            boost::mutex::scoped_lock lock(mStateMutex);
+            mPanTracked = false;
+        }
+        throw;
+    }
+
+    if (!arrived) {
+        forgetPos();
+        return false;
+    }
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    if (known)
+        mPredictor.observe(from, target, (base::Time::now() - start).toSeconds());
+    mLastPos = target;
+    mLastPosKnown[PAN] = mLastPosKnown[TILT] = !mContinuousPan;
     return true;
 }
 
+unsigned Driver::haltCount() const {
+
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    return scheduler ? scheduler->getHaltCount() : 0;
+}
+
+void Driver::forgetPos() {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mLastPosKnown[PAN] = mLastPosKnown[TILT] = false;
+}
+
+MovePredictor Driver::getPredictor() const {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    return mPredictor;
+}
+
+MovePrediction Driver::predictMove(const PanTiltTicks& target) {
+
+    PanTiltTicks from(getPos(PAN, false), getPos(TILT, false));
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    return mPredictor.predict(from, target);
+}
+
 
 void Driver::setSpeed(Axis axis, int speed) {
     
-    write(Cmd::setDesiredSpeed(speed,axis));
-   
-    readAns(); 
+    transact(Cmd::setDesiredSpeed(speed,axis), MOTION_LANE);
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    // in velocity mode the head moves off the remembered position
+    if (mConfig.ctrlMode == PURE)
+        mLastPosKnown[PAN] = mLastPosKnown[TILT] = false;
+    mMotion.axis(axis).speed = speed;
+    mPredictor.setMotionModel(mMotion);
 }
 
 void Driver::setSpeedDeg(Axis axis, float speed) {
     
-    int speed_pos_s;
+    setSpeed(axis, mUnits.axis(axis).degPerSecToTicks(speed));
+}
 
-    if ( axis == TILT )
-        speed_pos_s = speed / mTiltResolutionDeg;
-    else if (axis == PAN )
-        speed_pos_s = speed / mPanResolutionDeg;
+void Driver::setSpeedRad(Axis axis, float speed) {
 
-    setSpeed(axis,speed_pos_s);
+    setSpeed(axis, mUnits.axis(axis).radPerSecToTicks(speed));
 }
 
-void Driver::setSpeedRad(Axis axis, float speed) {
+void Driver::setAccel(Axis axis, int accel) {
+
+    transact(Cmd::setDesiredAccel(accel, axis), MOTION_LANE);
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mMotion.axis(axis).accel = accel;
+    mPredictor.setMotionModel(mMotion);
+}
+
+void Driver::setBaseSpeed(Axis axis, int speed) {
+
+    transact(Cmd::setDesiredBaseSpeed(speed, axis), MOTION_LANE);
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mMotion.axis(axis).baseSpeed = speed;
+    mPredictor.setMotionModel(mMotion);
+}
+
+size_t Driver::applyMotion(Axis axis, const AxisMotion& motion) {
+
+    AxisConfig current = getConfig().axis(axis);
+    AxisConfig target = current;
+    target.speed = round(motion.speed);
+    target.accel = round(motion.accel);
+    target.baseSpeed = round(motion.baseSpeed);
+
+    std::vector<std::string> commands = target.commandsFrom(axis, current);
+    if (commands.empty())
+        return 0;
+
+    try {
+        transactBatch(commands, MOTION_LANE);
+    } catch (const std::exception&) {
+        // some of the values may have been taken, read them again
+        try {
+            queryMotionModel();
+        } catch (const std::exception& e) {
+            LOG_WARN_S << "applyMotion: cannot read back the motion model: " << e.what();
+        }
+        throw;
+    }
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mMotion.axis(axis) = target.motion();
+    mPredictor.setMotionModel(mMotion);
+    return commands.size();
+}
+
+size_t Driver::sendMailboxSpeeds(VelocityMailbox& mailbox) {
+
+    size_t sent = 0;
+    int speed;
+
+    for (int i = 0; i < 2; ++i) {
+        Axis axis = i == 0 ? PAN : TILT;
+        if (!mailbox.take(axis, speed))
+            continue;
+
+        // a setpoint that did not make it is sent again next time
+        try {
+            setSpeed(axis, speed);
+        } catch (...) {
+            mailbox.retry(axis);
+            throw;
+        }
+        mailbox.markSent();
+        ++sent;
+    }
+
+    return sent;
+}
+
+void Driver::setCtrlMode(CtrllMode mode) {
+
+    transact(Cmd::setCtrlMode(mode), MOTION_LANE);
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mLastPosKnown[PAN] = mLastPosKnown[TILT] = false;
+    mConfig.ctrlMode = mode;
+}
+
+void Driver::setImmediatePosExec(bool immediate) {
+
+    transact(immediate ? Cmd::enableImmediatePosExec() : Cmd::enableSlavedPosExec(), MOTION_LANE);
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    mImmediatePosExec = immediate;
+}
+
+bool Driver::isImmediatePosExec() const {
+
+    boost::mutex::scoped_lock lock(mStateMutex);
+    return mImmediatePosExec;
+}
+
+StepMode Driver::getStepMode(Axis axis) {
+
+    std::string reply = transact(Cmd::getStepMode(axis), QUERY_LANE);
+
+    // the mode letter follows the reply marker, e.g. '* Q'
+    size_t pos = reply.find_first_of("FHQEA", 1);
+    if (pos == std::string::npos)
+        throw std::runtime_error("cannot parse step mode from reply: " + reply);
+
+    switch (reply[pos]) {
+        case 'F': return STEP_FULL;
+        case 'H': return STEP_HALF;
+        case 'Q': return STEP_QUARTER;
+        case 'E': return STEP_EIGHTH;
+        default:  return STEP_AUTO;
+    }
+}
+
+bool Driver::setStepMode(Axis axis, StepMode mode) {
+
+    double angle = getPosRad(axis, false);
+    double oldRes = mUnits.axis(axis).getResolutionDeg();
+    AxisMotion motion = getMotionModel().axis(axis);
+
+    transact(Cmd::setStepMode(mode, axis), MOTION_LANE);
+    queryGeometry(axis);
+
+    // new positions per old position
+    double ratio = oldRes / mUnits.axis(axis).getResolutionDeg();
+    if (std::fabs(ratio - 1) < 1e-6) {
+        LOG_INFO_S << "setStepMode: resolution unchanged, the unit may only apply the mode after a reset";
+        return true;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mStateMutex);
+        int& last = axis == PAN ? mLastPos.pan : mLastPos.tilt;
+        last = int(floor(last * ratio + 0.5));
+
+        if (axis == PAN) {
+            mLastPanTicks = int(floor(mLastPanTicks * ratio + 0.5));
+            mPanTurnTicks = (long long)(floor(mPanTurnTicks * ratio + 0.5));
+        }
+
+        // the speed limits are in positions as well
+        mConfigKnown = false;
+
+        std::vector<std::string> names = mConfigs.names();
+        for (size_t i = 0; i < names.size(); ++i) {
+            MotionConfig config = mConfigs.get(names[i]);
+            config.axis(axis) = config.axis(axis).scaled(ratio);
+            mConfigs.set(names[i], config);
+        }
+    }
+
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    if (axis == PAN && mContinuousPan && scheduler)
+        scheduler->setPanModulus(panTicksPerTurn());
+
+    // keep the angular speeds, the unit may or may not have rescaled them
+    double limit = getQuery<int>(transact(Cmd::getSpeedLimit(axis, UPPER), QUERY_LANE));
+    AxisMotion scaled(std::min(motion.speed * ratio, limit), motion.accel * ratio,
+                      std::min(motion.baseSpeed * ratio, limit));
+    queryMotionModel();
+    applyMotion(axis, scaled);
+
+    int pos = getPos(axis, false);
+    int expected = mUnits.axis(axis).radToTicks(angle);
+
+    if (std::abs(pos - expected) > std::max(1.0, ratio)) {
+        LOG_WARN_S << "setStepMode: position " << pos << " after the switch, expected " << expected
+                   << "; the axis needs a reset";
+        forgetPos();
+        return false;
+    }
+
+    return true;
+}
+
+void Driver::setHoldPower(Axis axis, PowerLevel level) {
+
+    transact(Cmd::setHoldPower(level, axis), MOTION_LANE);
+}
+
+void Driver::setMovePower(Axis axis, PowerLevel level) {
+
+    transact(Cmd::setMovePower(level, axis), MOTION_LANE);
+}
+
+static PowerLevel parsePowerLevel(const std::string& reply) {
+
+    // the level letter follows the reply marker, e.g. '* L'
+    size_t pos = reply.find_first_of("OLRH", 1);
+    if (pos == std::string::npos)
+        throw std::runtime_error("cannot parse power level from reply: " + reply);
+
+    switch (reply[pos]) {
+        case 'O': return POWER_OFF;
+        case 'L': return POWER_LOW;
+        case 'R': return POWER_REGULAR;
+        default:  return POWER_HIGH;
+    }
+}
+
+PowerLevel Driver::getHoldPower(Axis axis) {
+
+    return parsePowerLevel(transact(Cmd::getHoldPower(axis), QUERY_LANE));
+}
+
+PowerLevel Driver::getMovePower(Axis axis) {
 
-    setSpeedDeg(axis, speed * 180.0 / M_PI);
+    return parsePowerLevel(transact(Cmd::getMovePower(axis), QUERY_LANE));
 }
 
 void Driver::setHalt() {
 
-    write(Cmd::haltPosCmd(true,true));
-    readAns();
+    boost::shared_ptr<CommandScheduler> scheduler = getScheduler();
+    if (scheduler)
+        scheduler->halt();
+    else
+        transact(Cmd::haltPosCmd(true,true), EMERGENCY_LANE);
 }
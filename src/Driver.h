@@ -11,31 +11,157 @@
 // Includes
 //==============================================================================
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <base-logging/Logging.hpp>
 #include "iodrivers_base/Driver.hpp"
 
 #include "Cmd.h"
+#include "CommandScheduler.h"
+#include "MotionConfig.h"
+#include "MotionGuard.h"
+#include "MotionModel.h"
+#include "MovePredictor.h"
+#include "ReplayStream.h"
+#include "SerialTuning.h"
+#include "TrafficLog.h"
+#include "Units.h"
+#include "VelocityMailbox.h"
 
 //==============================================================================
 // Declaration
 //==============================================================================
 namespace ptu {
 
+/**
+ * The reply to a command did not arrive before its deadline. The link is
+ * cleared, a late reply may still arrive and is then dropped as garbage by
+ * the next read at best.
+ */
+class DeadlineError : public iodrivers_base::TimeoutError {
+private:
+    std::string mCommand;
+    base::Time mDeadline;
+
+public:
+    DeadlineError(const std::string& command, const base::Time& deadline);
+    ~DeadlineError() throw() {}
+
+    /** The command that got no reply. */
+    const std::string& getCommand() const { return mCommand; }
+
+    /** How long the reply was waited for. */
+    const base::Time& getDeadline() const { return mDeadline; }
+};
+
+/**
+ * What Driver::initialize does besides querying the unit. The defaults leave
+ * the unit as it is.
+ */
+struct StartupOptions {
+    bool setResetMode;      //!< store resetMode as the power-up reset mode
+    ResetMode resetMode;    //!< e.g. RESET_NONE to skip homing after power blips
+    bool resetPan;          //!< home the pan axis
+    bool resetTilt;         //!< home the tilt axis
+    bool checkPosition;     //!< check the axes not homed against expected, see Driver::checkPosition
+    PanTiltTicks expected;  //!< the last position saved before power down
+    int tolerance;          //!< accepted deviation from expected, in positions
+    int jog;                //!< test move distance of the check, 0 to skip it
+    bool resetOnFailure;    //!< home an axis failing the check, else throw
+
+    StartupOptions();
+};
+
 class Driver : public iodrivers_base::Driver {
 private:
     static const int DEFAULT_BAUDRATE;  //!< The default baudrate that the ptu starts with.
     static const int MAX_PACKET_SIZE;   //!< The maximum packet size.
-    static const float DEGREEPERTICK; //!< Degrees per tick. (same for TILT AND PAN) //TODO maybe calculated??
+    static const float DEGREEPERTICK; //!< Default degrees per tick, until the resolution is queried.
     static const float DEGREEPERSECARC; //!<  Used for computing the resolution.
 
-    float mPanResolutionDeg;
-    float mTiltResolutionDeg;
+    Units mUnits;   //!< Tick/angle conversions, driven by the queried resolutions.
+    MotionModel mMotion;    //!< Last known speeds and accelerations of the unit.
+    MovePredictor mPredictor;   //!< Move durations, calibrated by the awaited moves.
+    MotionGuard mGuard;         //!< Soft limits from the queried geometry, keep-out zones.
+    MotionConfig mConfig;       //!< Last known speed limits and control mode (speeds are in mMotion).
+    bool mConfigKnown;          //!< mConfig was read from or written to the unit.
+    bool mImmediatePosExec;     //!< Position execution mode last set, immediate at power up.
+    MotionConfigSet mConfigs;   //!< Named configurations for applyConfig.
+    PanTiltTicks mLastPos;      //!< Last known position of the unit.
+    bool mLastPosKnown[2];      //!< mLastPos is valid for an axis (no unawaited move since).
+    mutable boost::mutex mStateMutex;   //!< Guards the cached state updated at runtime.
+
+    /** Marks the position of both axes as unknown. */
+    void forgetPos();
+
+    /**
+     * Sends a coordinated move to \p target, without checking it. Both
+     * targets go out in one batch, so the axes start together.
+     * @param halts haltCount() read before the move was decided on
+     */
+    bool moveTo(const PanTiltTicks& target, bool awaitCompletion, unsigned halts);
+
+    /** The halt count of the scheduler, 0 without one. */
+    unsigned haltCount() const;
+
+    /** Queries resolution and position limits of \p axis. */
+    void queryGeometry(Axis axis);
+
+    /**
+     * Moves \p axis to \p target and awaits it.
+     * @return false if it did not arrive within its move deadline (see
+     *         getMoveDeadline) or a halt preempted it
+     */
+    bool jogTo(Axis axis, int target);
+
+    /**
+     * Predicted duration of a move from \p from to \p target on \p axis,
+     * or over the whole axis range if the start is not \p known.
+     */
+    double awaitDuration(Axis axis, int from, int target, bool known) const;
+
+    /**
+     * Brings the link back in step after \p pending replies missed their
+     * deadline: sends a query and drops the replies up to its answer, so a
+     * late reply is not taken for the answer of the next command.
+     */
+    void resync(size_t pending);
     
     float mMinPanRad;
     float mMaxPanRad;
     float mMinTiltRad;
     float mMaxTiltRad;
 
+    boost::shared_ptr<TrafficLogWriter> mRecording;
+    boost::shared_ptr<CommandScheduler> mScheduler;
+    mutable boost::mutex mSchedulerMutex;   //!< Guards mScheduler, callers use copies.
+    QueryScheduler* mQueries;
+    int mBaudrate;
+    int mSerialTuning;              //!< SerialTuning flags in effect on the port.
+    std::string mSerialPort;        //!< The port opened with the low latency settings.
+    int mSavedLatencyTimer;         //!< Latency timer replaced on mSerialPort, -1 if none.
+
+    /** Puts back the latency timer replaced by openSerial, if any. */
+    void restoreLatencyTimer();
+
+    base::Time mUnitLatency;        //!< Worst-case processing time of the unit per command.
+    base::Time mDeadlineMargin;     //!< Added to every deadline, for the host side.
+    double mMoveMargin;             //!< Relative margin on predicted move durations.
+
+    bool mContinuousPan;        //!< Pan limits disabled, pan tracked over multiple turns.
+    bool mPanTracked;           //!< mLastPanTicks holds a valid reading.
+    int mLastPanTicks;          //!< Last pan position reported by the unit.
+    long long mPanTurnTicks;    //!< Multi-turn pan position, in positions.
+
+    /** Positions per full pan revolution. */
+    int panTicksPerTurn() const;
+
+    /** Folds the pan reading \p ticks into the multi-turn position. */
+    void trackPan(int ticks);
+
+    /** Shortest signed pan offset from the current position to the absolute \p target. */
+    int shortestPanOffset(int target);
+
 protected:
     /**
      * Find a packet into the currently accumulated data.
@@ -58,8 +184,263 @@ public:
     /** The maximum tilt postion in rad. */
     float getMaxTiltRad() { return mMaxTiltRad; }
 
-    /** Initial communication with the device to set proper modes and query limits. */
-    void initialize();
+    /**
+     * Enables or disables continuous pan rotation. When enabled, the pan
+     * limits of the unit are turned off (min/max pan no longer apply), the
+     * pan angle is tracked over multiple turns, and absolute pan targets are
+     * reached by the shortest signed offset move, i.e. at most half a turn.
+     * Only use it on units built for continuous rotation.
+     * @throws std::runtime_error when enabling it with keep-out zones set,
+     *         which are not checked in continuous pan mode
+     */
+    void setContinuousPan(bool enable);
+
+    /** True if continuous pan rotation is enabled. */
+    bool isContinuousPan() const { return mContinuousPan; }
+
+    /** Queries whether the pan position limits are enabled on the unit. */
+    bool getPanLimitMode();
+
+    /**
+     * The pan angle accumulated over all turns since continuous pan was
+     * enabled, e.g. 3*PI after one and a half turns. Queries the position.
+     */
+    double getPanMultiTurnRad();
+
+    /**
+     * The conversions used by every degree/radian method of the driver.
+     * Converting with them yields exactly the positions the driver sends.
+     */
+    const Units& getUnits() const { return mUnits; }
+
+    /**
+     * The motion parameters last queried with queryMotionModel() or set
+     * through this driver.
+     */
+    MotionModel getMotionModel() const;
+
+    /** Queries desired speed, acceleration and base speed of both axes. */
+    MotionModel queryMotionModel();
+
+    /**
+     * The motion configuration last read with snapshotConfig() or set
+     * through this driver. Only valid after one of them was called.
+     */
+    MotionConfig getConfig() const;
+
+    /**
+     * Reads the complete motion configuration of the unit in one batch.
+     * Applying the snapshot later restores it.
+     */
+    MotionConfig snapshotConfig();
+
+    /**
+     * Brings the unit to \p config, sending only the settings that differ
+     * from the last known configuration as one batch (see
+     * MotionConfig::commandsFrom). The configuration is read first if it
+     * is not known yet.
+     * @return the number of commands sent
+     */
+    size_t applyConfig(const MotionConfig& config);
+
+    /** Defines or replaces the named configuration \p name. */
+    void defineConfig(const std::string& name, const MotionConfig& config);
+
+    /**
+     * Applies the configuration defined as \p name.
+     * @throws std::runtime_error if there is none
+     */
+    size_t applyConfig(const std::string& name);
+
+    /**
+     * A copy of the move duration predictor. It follows the motion model
+     * and is calibrated by every awaited move whose start position is known,
+     * so copy it again from time to time. Evaluating many candidate targets
+     * on the copy does not touch the driver.
+     */
+    MovePredictor getPredictor() const;
+
+    /**
+     * Predicts the duration and arrival time per axis of a move from the
+     * current position (queried from the unit) to \p target.
+     */
+    MovePrediction predictMove(const PanTiltTicks& target);
+
+    /** Opens the serial \p port, remembering \p baudrate for latency bounds. */
+    bool openSerial(std::string const& port, int baudrate);
+
+    /**
+     * Opens the serial \p port and, if \p lowLatency is set, tunes it for
+     * short replies (see SerialTuning). Settings that cannot be applied,
+     * e.g. on a pty or without the permissions, are logged and skipped.
+     * The latency timer of a USB adapter is restored when the driver closes
+     * the port, opens another one or is destroyed.
+     */
+    bool openSerial(std::string const& port, int baudrate, bool lowLatency);
+
+    /**
+     * Closes the port and restores the latency timer replaced by openSerial.
+     * iodrivers_base::Driver::close is not virtual: closing through a base
+     * class reference leaves the timer to the destructor.
+     */
+    void close();
+
+    /** The SerialTuning flags in effect since the port was opened, 0 if none. */
+    int getSerialTuning() const { return mSerialTuning; }
+
+    /**
+     * Initial communication with the device to set proper modes and query
+     * limits, then the reset handling selected by \p options.
+     * @throws std::runtime_error if a position check fails and
+     *         options.resetOnFailure is false
+     */
+    void initialize(const StartupOptions& options = StartupOptions());
+
+    /** Queries the axes the unit resets at power up. */
+    ResetMode getResetMode();
+
+    /** Sets the axes the unit resets at the next power up. */
+    void setResetMode(ResetMode mode);
+
+    /**
+     * Homes the selected axes now. A single axis is reset by selecting it
+     * in the reset mode for the duration of the reset. The reply is awaited
+     * for at most \p timeout, homing takes several seconds per axis.
+     *
+     * The unit answers no other command while homing, so the reset holds
+     * the wire until its reply: with the scheduler running, a halt waits up
+     * to \p timeout and CommandScheduler::getHaltLatencyBound() does not
+     * hold meanwhile.
+     */
+    void reset(bool pan = true, bool tilt = true,
+               const base::Time& timeout = base::Time::fromSeconds(60));
+
+    /**
+     * Quick check that \p axis still knows its position, instead of homing
+     * it: the position must be within \p tolerance of \p expected, e.g. the
+     * position saved before power down, and the axis must follow a test move
+     * of \p jog positions and back within the predicted time. Takes well
+     * below a second.
+     *
+     * Only the comparison with \p expected detects lost steps. The test move
+     * is checked against the unit's own position counter, which counts the
+     * steps sent whether the motor followed them or not; it only shows that
+     * the axis is powered and answers.
+     * @return false if the check failed
+     */
+    bool checkPosition(Axis axis, int expected, int tolerance = 0, int jog = 50);
+
+    /**
+     * Routes all further commands through a CommandScheduler, which sends
+     * them by priority from its own I/O thread. Halts then overtake queued
+     * commands and preempt awaited moves (see CommandScheduler).
+     *
+     * Once started, the driver may be shared between threads: every
+     * command, including raw ones sent with transact(), gets its own reply.
+     * write() and readAns() must then no longer be called directly.
+     */
+    void startScheduler();
+
+    /**
+     * Stops the scheduler, commands are sent from the calling thread again.
+     * Commands that race with the stop are either sent before it or fail
+     * with std::runtime_error; once it returned, the driver must be used by
+     * one thread at a time again.
+     */
+    void stopScheduler();
+
+    /**
+     * Runs the periodic queries of \p queries in the idle time of the
+     * scheduler, which is started if needed. 0 stops them. \p queries must
+     * outlive its use by the driver.
+     */
+    void setQueryScheduler(QueryScheduler* queries);
+
+    /** The running scheduler, or null. The copy stays valid after a stop. */
+    boost::shared_ptr<CommandScheduler> getScheduler() const;
+
+    /**
+     * Sends \p msg and reads the answer, through the scheduler if it runs.
+     * @param msg the message to be sent
+     * @param lane the priority of the message when scheduled
+     * @param timeout how long to wait for the answer, by default the query
+     *        deadline of \p msg (see getQueryDeadline)
+     * @return answer string
+     * @throws DeadlineError if the answer did not arrive in time
+     */
+    std::string transact(const std::string& msg, Lane lane = QUERY_LANE,
+                         const base::Time& timeout = base::Time());
+
+    /**
+     * Writes \p msg and waits at most \p timeout for its answer, without
+     * the scheduler.
+     * @throws DeadlineError if the answer did not arrive in time; the link
+     *         is resynchronized first (see resync)
+     */
+    std::string exchange(const std::string& msg, const base::Time& timeout);
+
+    /**
+     * How long the answers to \p replies commands totalling \p sentBytes
+     * bytes may take: the bytes on the wire both ways at the baud rate, the
+     * unit latency per command and the deadline margin. A position query at
+     * 9600 baud gets about 40ms with the defaults, instead of the global
+     * read timeout.
+     */
+    base::Time getQueryDeadline(size_t sentBytes, size_t replies = 1) const;
+
+    /**
+     * How long an awaited move predicted to take \p seconds may take before
+     * its completion reply is considered lost.
+     */
+    base::Time getMoveDeadline(double seconds) const;
+
+    /**
+     * Sets the worst-case time the unit needs to answer a command once
+     * received (5ms by default) and the margin added to every deadline for
+     * the host side (20ms by default; USB adapters buffer up to 16ms).
+     */
+    void setDeadlines(const base::Time& unitLatency, const base::Time& margin);
+
+    /** Relative margin on the predicted duration of awaited moves, 0.5 by default. */
+    void setMoveDeadlineMargin(double margin) { mMoveMargin = margin; }
+
+    /**
+     * Sends \p msgs as one batch and reads their answers, through the
+     * scheduler if it runs. The unit executes the commands in order.
+     * @param lane the priority of the batch when scheduled
+     * @return the answers, one per message
+     */
+    std::vector<std::string> transactBatch(const std::vector<std::string>& msgs,
+                                           Lane lane = QUERY_LANE);
+
+    /**
+     * Writes \p msgs to the device at once and reads one answer per
+     * message. Failed commands do not stop the batch: all answers are read
+     * before the first error is thrown, so the link stays in sync.
+     * @throws std::runtime_error on the first failed command
+     * @throws DeadlineError if an answer does not arrive within the query
+     *         deadline of the whole batch
+     */
+    std::vector<std::string> exchange(const std::vector<std::string>& msgs);
+
+    /**
+     * Starts logging all raw traffic on the open device into \p path.
+     * The log can later be fed back with openReplay.
+     * @throws std::runtime_error if the device is not a file descriptor
+     *         or the log cannot be created
+     */
+    void startRecording(const std::string& path);
+
+    /** Stops logging and closes the traffic log. */
+    void stopRecording();
+
+    /**
+     * Uses a traffic log recorded by startRecording instead of a device.
+     * The driver must then send exactly the recorded commands.
+     * @param path the traffic log
+     * @param mode replay at recorded timing or as fast as possible
+     */
+    void openReplay(const std::string& path, ReplayMode mode = REPLAY_REALTIME);
 
     /**
      * Sends a message to the device.
@@ -77,12 +458,18 @@ public:
     //TODO fix timeout! Could be remove could be set via iodrivers_base?
     std::string readAns();
 
+    /**
+     * Read the answer of a query, waiting at most \p timeout.
+     * @throws iodrivers_base::TimeoutError if no answer arrived in time
+     */
+    std::string readAns(const base::Time& timeout);
+
     /**
      * Converts an \p answer to a value of type T.
      * The answer string is like '* <result><CR>'.
      */
     template<typename T>
-    T getQuery(const std::string& answer) {
+    static T getQuery(const std::string& answer) {
         return boost::lexical_cast<T>( answer.substr(2, answer.find_last_of("0123456789")-1) );
     }
 
@@ -111,7 +498,7 @@ public:
       * @param offset Select if the position should be set as an offset from current position
       *               or if false it will be set as absolute value (while 0 is front center).
       * @param awaitCompletion Set if movement should be completed before processing next command.
-      * @return Returns bool value. true if success, false otherwise. 
+      * @return Returns bool value. true if success, false otherwise (e.g. preempted by a halt). 
       */
     bool setPosDeg(const Axis &axis, const bool &offset, const float &val, const bool &awaitCompletion = false);
 
@@ -120,16 +507,52 @@ public:
 
     /**
      * Set current pan-tilt position.
+     * The target is checked against the soft limits first, which needs the
+     * current position for offsets; with keep-out zones defined, the move
+     * is made as a coordinated move (see setPos(const PanTiltTicks&, const bool&)).
      * @param val the value to which to set the position
      * @param axis the axis to be used
      * @param offset if true, the relative value is used
      * @param awaitCompletion force the command to be completed 
      *        before next command will be processed.
-     * @return true if successful
+     * @return true if successful, false if a halt preempted the awaited move
+     * @throws std::runtime_error if the target is outside the soft limits
      */
     bool setPos(const Axis& axis, const bool& offset = false, const int& val = 0, 
                 const bool& awaitCompletion = false);
 
+    /**
+     * Moves both axes at once to an absolute position. If the direct move
+     * would cross a keep-out zone, the head is routed around it over
+     * awaited intermediate waypoints (see MotionGuard). With zones, the move
+     * is checked from the position queried right before.
+     * @param target the pan and tilt positions
+     * @param awaitCompletion wait until both axes arrived
+     * @return true if successful, false if a halt preempted the move or the
+     *         route
+     * @throws std::runtime_error if \p target is outside the soft limits or
+     *         in a keep-out zone, before anything is sent
+     */
+    bool setPos(const PanTiltTicks& target, const bool& awaitCompletion = false);
+
+    /**
+     * Adds a keep-out zone, a polygon in pan/tilt angles the head must
+     * neither stop in nor pass through. Zones are checked by setPos, not in
+     * velocity mode. Set them up before sharing the driver between threads.
+     * @throws std::runtime_error in continuous pan mode, where moves take
+     *         the shortest way around and are not checked against zones
+     */
+    void addKeepOutZone(const MotionGuard::Polygon& polygon);
+
+    /** Removes all keep-out zones. */
+    void clearKeepOutZones();
+
+    /** Sets the distance kept to the keep-out zones, in radians (0.02 by default). */
+    void setKeepOutClearance(double clearance);
+
+    /** The soft limits and keep-out zones setPos checks targets against. */
+    const MotionGuard& getMotionGuard() const { return mGuard; }
+
     /** Set desired \p speed for an \p axis in positions/second. */
     void setSpeed(Axis axis, int speed);
     
@@ -139,7 +562,76 @@ public:
     /** Set desired \p speed for an \p axis in radian/second. */
     void setSpeedRad(Axis axis, float speed);
 
-    /** Stops motion. */
+    /** Set desired \p accel for an \p axis in positions/second^2. */
+    void setAccel(Axis axis, int accel);
+
+    /** Set the base (start-up) \p speed for an \p axis in positions/second. */
+    void setBaseSpeed(Axis axis, int speed);
+
+    /**
+     * Sets speed, acceleration and base speed of \p axis, sending only the
+     * values that differ from the cached motion model, in the order of
+     * AxisConfig::commandsFrom.
+     * @return the number of commands sent
+     */
+    size_t applyMotion(Axis axis, const AxisMotion& motion);
+
+    /**
+     * Sends the newest unsent speed setpoint of each axis in \p mailbox.
+     * Meant to be called from the thread owning the driver, typically in a
+     * loop waiting on VelocityMailbox::wait(). A setpoint whose command
+     * fails stays pending for the next call.
+     * @return the number of setpoints sent
+     */
+    size_t sendMailboxSpeeds(VelocityMailbox& mailbox);
+
+    /**
+     * Set the speed control mode. In pure velocity mode (PURE) the desired
+     * speed is signed and the unit moves until told otherwise.
+     */
+    void setCtrlMode(CtrllMode mode);
+
+    /**
+     * Selects immediate (true) or slaved (false) position execution. In
+     * slaved mode, position commands only start with an await command.
+     */
+    void setImmediatePosExec(bool immediate);
+
+    /** The position execution mode last set with setImmediatePosExec(). */
+    bool isImmediatePosExec() const;
+
+    /** Query the step mode of \p axis. */
+    StepMode getStepMode(Axis axis);
+
+    /**
+     * Switches the step mode of \p axis, e.g. full steps to slew fast and
+     * eighth steps for fine pointing. The resolution and the limits are
+     * queried again, so every conversion of the driver follows, and the
+     * cached positions are rescaled. The speed, acceleration and base speed
+     * are resent as needed to keep their angular values, within the upper
+     * speed limit, and the configurations given to defineConfig() are
+     * rescaled. Angular copies of the limits (LookAt, the MotionGuard) stay
+     * valid; copies of the Units, e.g. given to StatePublisher::attach(),
+     * have to be updated with getUnits().
+     * Must not run concurrently with moves or conversions of other threads.
+     * @return false if the unit did not keep the angular position (its
+     *         position counter was not rescaled); the axis then needs a reset
+     */
+    bool setStepMode(Axis axis, StepMode mode);
+
+    /** Set the power level of \p axis while it stands still. */
+    void setHoldPower(Axis axis, PowerLevel level);
+
+    /** Set the power level of \p axis while it moves. */
+    void setMovePower(Axis axis, PowerLevel level);
+
+    /** Query the power level of \p axis while it stands still. */
+    PowerLevel getHoldPower(Axis axis);
+
+    /** Query the power level of \p axis while it moves. */
+    PowerLevel getMovePower(Axis axis);
+
+    /** Stops motion. Overtakes queued commands when the scheduler runs. */
     void setHalt();
 };
     
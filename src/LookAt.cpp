@@ -0,0 +1,156 @@
+/**
+  * Pointing the Pan-Tilt Unit at 3D points.
+  * @file LookAt.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "LookAt.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <cmath>
+#include <limits>
+using namespace std;
+
+//==============================================================================
+// Static members initialization
+//==============================================================================
+const double LookAt::TWO_PI = 2 * M_PI;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+bool LookAt::inLimits(PanTiltRad& angles) const {
+    if (angles.tilt < mMinTilt || angles.tilt > mMaxTilt) {
+        return false;
+    }
+
+    // the same heading may be in the pan range one turn further
+    if (angles.pan < mMinPan) {
+        angles.pan += TWO_PI;
+    } else if (angles.pan > mMaxPan) {
+        angles.pan -= TWO_PI;
+    }
+    return angles.pan >= mMinPan && angles.pan <= mMaxPan;
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+LookAt::LookAt(const HeadModel& model) :
+        mMinPan(-numeric_limits<double>::infinity()),
+        mMaxPan(numeric_limits<double>::infinity()),
+        mMinTilt(-numeric_limits<double>::infinity()),
+        mMaxTilt(numeric_limits<double>::infinity())
+{
+    setModel(model);
+}
+
+void LookAt::setModel(const HeadModel& model) {
+    mModel = model;
+
+    base::Affine3d toBase = model.mounting.inverse();
+    mToBaseRotation = toBase.linear();
+    mToBaseTranslation = toBase.translation();
+}
+
+void LookAt::setLimits(double minPan, double maxPan, double minTilt, double maxTilt) {
+    mMinPan = minPan;
+    mMaxPan = maxPan;
+    mMinTilt = minTilt;
+    mMaxTilt = maxTilt;
+}
+
+void LookAt::setLimits(Driver& driver) {
+    if (driver.isContinuousPan()) {
+        setLimits(-numeric_limits<double>::infinity(), numeric_limits<double>::infinity(),
+                  driver.getMinTiltRad(), driver.getMaxTiltRad());
+    } else {
+        setLimits(driver.getMinPanRad(), driver.getMaxPanRad(),
+                  driver.getMinTiltRad(), driver.getMaxTiltRad());
+    }
+}
+
+bool LookAt::solve(const base::Vector3d& point, PanTiltRad& angles) const {
+    const base::Vector3d& a = mModel.tiltOffset;
+    const base::Vector3d& c = mModel.cameraOffset;
+    base::Vector3d p = mToBaseRotation * point + mToBaseTranslation;
+
+    // pan: the point must end up at the lateral offset of the camera
+    double lateral = a.y() + c.y();
+    double rho2 = p.x() * p.x() + p.y() * p.y();
+    if (rho2 <= lateral * lateral) {
+        return false;
+    }
+    double rho = sqrt(rho2);
+    angles.pan = atan2(p.y(), p.x()) - asin(lateral / rho);
+
+    // tilt: likewise in the panned frame, relative to the tilt axis
+    double u = sqrt(rho2 - lateral * lateral) - a.x();
+    double w = p.z() - a.z();
+    double sigma2 = u * u + w * w;
+    if (sigma2 <= c.z() * c.z()) {
+        return false;
+    }
+    double sigma = sqrt(sigma2);
+    angles.tilt = atan2(w, u) - asin(c.z() / sigma);
+
+    // the point must be in front of the optical center
+    if (sqrt(sigma2 - c.z() * c.z()) <= c.x()) {
+        return false;
+    }
+
+    if (angles.pan > M_PI) {
+        angles.pan -= TWO_PI;
+    } else if (angles.pan <= -M_PI) {
+        angles.pan += TWO_PI;
+    }
+
+    return inLimits(angles);
+}
+
+size_t LookAt::solve(const vector<base::Vector3d>& points, vector<PanTiltRad>& angles,
+                     vector<unsigned char>& reachable) const
+{
+    angles.resize(points.size());
+    reachable.resize(points.size());
+
+    size_t count = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        reachable[i] = solve(points[i], angles[i]);
+        count += reachable[i];
+    }
+    return count;
+}
+
+void LookAt::ray(const PanTiltRad& angles, base::Vector3d& origin, base::Vector3d& direction) const {
+    double cp = cos(angles.pan), sp = sin(angles.pan);
+    double ct = cos(angles.tilt), st = sin(angles.tilt);
+
+    // the tilted frame in the panned frame: x forward and up, y unchanged
+    base::Matrix3d tilt;
+    tilt << ct, 0, -st,
+            0,  1, 0,
+            st, 0, ct;
+
+    base::Matrix3d pan;
+    pan << cp, -sp, 0,
+           sp, cp,  0,
+           0,  0,   1;
+
+    base::Matrix3d toBase = pan * tilt;
+    base::Vector3d center = pan * mModel.tiltOffset + toBase * mModel.cameraOffset;
+
+    origin = mModel.mounting * center;
+    direction = mModel.mounting.linear() * toBase.col(0);
+}
+
+bool LookAt::lookAt(Driver& driver, const base::Vector3d& point, bool awaitCompletion) const {
+    PanTiltRad angles;
+    if (!solve(point, angles)) {
+        return false;
+    }
+    return driver.setPos(driver.getUnits().toTicks(angles), awaitCompletion);
+}
@@ -0,0 +1,122 @@
+/**
+  * Pointing the Pan-Tilt Unit at 3D points.
+  * @file LookAt.h
+  */
+
+#ifndef LOOK_AT_H_
+#define LOOK_AT_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <vector>
+
+#include <base/Eigen.hpp>
+
+#include "Units.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+class Driver;
+
+/**
+ * Kinematics of a camera head on the unit.
+ *
+ * The base frame of the unit has x forward, z up along the pan axis. Panning
+ * rotates about z, positive to the left; tilting rotates about the y axis of
+ * the panned frame, positive up. The camera looks along the x axis of the
+ * tilted frame. All lengths are in the unit of the target points.
+ */
+struct HeadModel {
+    /** Pose of the base frame of the unit in the frame of the target points. */
+    base::Affine3d mounting;
+    /** Origin of the tilt axis in the panned frame. */
+    base::Vector3d tiltOffset;
+    /** Optical center of the camera in the tilted frame. */
+    base::Vector3d cameraOffset;
+
+    HeadModel() :
+        mounting(base::Affine3d::Identity()),
+        tiltOffset(base::Vector3d::Zero()),
+        cameraOffset(base::Vector3d::Zero()) {}
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * Closed-form inverse kinematics of a HeadModel: the pan and tilt angles
+ * that put a point on the optical axis of the camera.
+ *
+ * Offsets of the axes and the camera are handled exactly: the pan angle
+ * follows from the distance of the point to the pan axis and the lateral
+ * offset of the camera, then the tilt angle likewise in the panned frame.
+ * A solution costs one affine transform, two atan2, two asin and two square
+ * roots, so scoring tens of thousands of candidate points per second is
+ * cheap. Only the solution looking forward with the camera upright is used.
+ */
+class LookAt {
+private:
+    HeadModel mModel;
+    base::Matrix3d mToBaseRotation;     //!< inverse of the mounting
+    base::Vector3d mToBaseTranslation;
+
+    double mMinPan, mMaxPan;
+    double mMinTilt, mMaxTilt;
+
+    static const double TWO_PI;
+
+    bool inLimits(PanTiltRad& angles) const;
+
+public:
+    /** Without limits until setLimits is called. */
+    explicit LookAt(const HeadModel& model = HeadModel());
+
+    void setModel(const HeadModel& model);
+    const HeadModel& getModel() const { return mModel; }
+
+    /** Restricts the solutions to the given angles in radians. */
+    void setLimits(double minPan, double maxPan, double minTilt, double maxTilt);
+
+    /**
+     * Restricts the solutions to the limits queried by \p driver. The pan
+     * limits are dropped in continuous pan mode.
+     */
+    void setLimits(Driver& driver);
+
+    /**
+     * The angles pointing the camera at \p point.
+     * @return false if the point is too close to the axes to be looked at or
+     *         the angles are outside the limits; \p angles is then undefined
+     */
+    bool solve(const base::Vector3d& point, PanTiltRad& angles) const;
+
+    /**
+     * Solves every point in \p points.
+     * @param reachable set to 1 for the points with a solution, 0 otherwise
+     * @return the number of reachable points
+     */
+    size_t solve(const std::vector<base::Vector3d>& points, std::vector<PanTiltRad>& angles,
+                 std::vector<unsigned char>& reachable) const;
+
+    /**
+     * Forward kinematics: optical center and viewing direction of the camera
+     * at \p angles, in the frame of the target points.
+     */
+    void ray(const PanTiltRad& angles, base::Vector3d& origin, base::Vector3d& direction) const;
+
+    /**
+     * Points the camera at \p point with a coordinated move of both axes.
+     * @return false if the point is unreachable (nothing is sent) or a halt
+     *         preempted the awaited move
+     */
+    bool lookAt(Driver& driver, const base::Vector3d& point, bool awaitCompletion = false) const;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+} /* namespace ptu */
+
+#endif /* LOOK_AT_H_ */
@@ -0,0 +1,148 @@
+/**
+  * Complete motion configuration of the Pan-Tilt Unit, applied by difference.
+  * @file MotionConfig.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "MotionConfig.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <cmath>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// AxisConfig / MotionConfig
+//==============================================================================
+bool AxisConfig::operator==(const AxisConfig& other) const {
+    return speed == other.speed && accel == other.accel && baseSpeed == other.baseSpeed &&
+           upperSpeedLimit == other.upperSpeedLimit && lowerSpeedLimit == other.lowerSpeedLimit;
+}
+
+AxisConfig AxisConfig::scaled(double ratio) const {
+    return AxisConfig(int(floor(speed * ratio + 0.5)), int(floor(accel * ratio + 0.5)),
+                      int(floor(baseSpeed * ratio + 0.5)), int(floor(upperSpeedLimit * ratio + 0.5)),
+                      int(floor(lowerSpeedLimit * ratio + 0.5)));
+}
+
+vector<string> AxisConfig::commandsFrom(const Axis& axis, const AxisConfig& from) const {
+    const AxisConfig& to = *this;
+    vector<string> commands;
+
+    // widen the speed limits before the speeds change
+    if (to.upperSpeedLimit > from.upperSpeedLimit) {
+        commands.push_back(Cmd::setSpeedLimit(to.upperSpeedLimit, axis, UPPER));
+    }
+    if (to.lowerSpeedLimit < from.lowerSpeedLimit) {
+        commands.push_back(Cmd::setSpeedLimit(to.lowerSpeedLimit, axis, LOWER));
+    }
+
+    // the base speed must stay below the desired speed at all times
+    int speed = from.speed;
+    if (to.baseSpeed != from.baseSpeed && to.baseSpeed > from.speed) {
+        commands.push_back(Cmd::setDesiredSpeed(to.speed, axis));
+        speed = to.speed;
+    }
+    if (to.baseSpeed != from.baseSpeed) {
+        commands.push_back(Cmd::setDesiredBaseSpeed(to.baseSpeed, axis));
+    }
+    if (to.speed != speed) {
+        commands.push_back(Cmd::setDesiredSpeed(to.speed, axis));
+    }
+    if (to.accel != from.accel) {
+        commands.push_back(Cmd::setDesiredAccel(to.accel, axis));
+    }
+
+    // and narrow them once the speeds fit
+    if (to.upperSpeedLimit < from.upperSpeedLimit) {
+        commands.push_back(Cmd::setSpeedLimit(to.upperSpeedLimit, axis, UPPER));
+    }
+    if (to.lowerSpeedLimit > from.lowerSpeedLimit) {
+        commands.push_back(Cmd::setSpeedLimit(to.lowerSpeedLimit, axis, LOWER));
+    }
+
+    return commands;
+}
+
+bool MotionConfig::operator==(const MotionConfig& other) const {
+    return pan == other.pan && tilt == other.tilt && ctrlMode == other.ctrlMode;
+}
+
+vector<string> MotionConfig::commandsFrom(const MotionConfig& current) const {
+    vector<string> commands;
+
+    // in pure velocity mode every speed change moves the head
+    if (ctrlMode != current.ctrlMode && ctrlMode == INDEP) {
+        commands.push_back(Cmd::setCtrlMode(INDEP));
+    }
+
+    vector<string> axis = pan.commandsFrom(PAN, current.pan);
+    commands.insert(commands.end(), axis.begin(), axis.end());
+    axis = tilt.commandsFrom(TILT, current.tilt);
+    commands.insert(commands.end(), axis.begin(), axis.end());
+
+    if (ctrlMode != current.ctrlMode && ctrlMode == PURE) {
+        commands.push_back(Cmd::setCtrlMode(PURE));
+    }
+
+    return commands;
+}
+
+vector<string> MotionConfig::queries() {
+    vector<string> queries;
+
+    for (int i = 0; i < 2; ++i) {
+        Axis axis = i == 0 ? PAN : TILT;
+        queries.push_back(Cmd::getDesiredSpeed(axis));
+        queries.push_back(Cmd::getDesiredAccel(axis));
+        queries.push_back(Cmd::getDesiredBaseSpeed(axis));
+        queries.push_back(Cmd::getSpeedLimit(axis, UPPER));
+        queries.push_back(Cmd::getSpeedLimit(axis, LOWER));
+    }
+    queries.push_back(Cmd::getCtrlMode());
+
+    return queries;
+}
+
+MotionConfig MotionConfig::parse(const vector<string>& replies) {
+    if (replies.size() != 11) {
+        throw std::runtime_error("MotionConfig::parse: expected the 11 replies to queries()");
+    }
+
+    MotionConfig config;
+
+    for (int i = 0; i < 2; ++i) {
+        AxisConfig& axis = config.axis(i == 0 ? PAN : TILT);
+        axis.speed = Driver::getQuery<int>(replies[5 * i]);
+        axis.accel = Driver::getQuery<int>(replies[5 * i + 1]);
+        axis.baseSpeed = Driver::getQuery<int>(replies[5 * i + 2]);
+        axis.upperSpeedLimit = Driver::getQuery<int>(replies[5 * i + 3]);
+        axis.lowerSpeedLimit = Driver::getQuery<int>(replies[5 * i + 4]);
+    }
+
+    // the terse reply names the mode by its set command letter, 'I' or 'V'
+    config.ctrlMode = replies[10].find('V') != string::npos ? PURE : INDEP;
+    return config;
+}
+
+//==============================================================================
+// MotionConfigSet
+//==============================================================================
+const MotionConfig& MotionConfigSet::get(const string& name) const {
+    map<string, MotionConfig>::const_iterator it = mConfigs.find(name);
+    if (it == mConfigs.end()) {
+        throw std::runtime_error("MotionConfigSet: no configuration named " + name);
+    }
+    return it->second;
+}
+
+vector<string> MotionConfigSet::names() const {
+    vector<string> names;
+    for (map<string, MotionConfig>::const_iterator it = mConfigs.begin(); it != mConfigs.end(); ++it) {
+        names.push_back(it->first);
+    }
+    return names;
+}
@@ -0,0 +1,119 @@
+/**
+  * Complete motion configuration of the Pan-Tilt Unit, applied by difference.
+  * @file MotionConfig.h
+  */
+
+#ifndef MOTION_CONFIG_H_
+#define MOTION_CONFIG_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Cmd.h"
+#include "MotionModel.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Motion settings of one axis, in positions/second and positions/second^2.
+ */
+struct AxisConfig {
+    int speed;              //!< desired speed
+    int accel;              //!< desired acceleration
+    int baseSpeed;          //!< base (start-up) speed
+    int upperSpeedLimit;    //!< highest desired speed the unit accepts
+    int lowerSpeedLimit;    //!< lowest desired speed the unit accepts
+
+    AxisConfig(int speed = 1000, int accel = 2000, int baseSpeed = 0,
+               int upperSpeedLimit = 2000, int lowerSpeedLimit = 0) :
+        speed(speed), accel(accel), baseSpeed(baseSpeed),
+        upperSpeedLimit(upperSpeedLimit), lowerSpeedLimit(lowerSpeedLimit) {}
+
+    /** The speed, acceleration and base speed as used by the MotionModel. */
+    AxisMotion motion() const { return AxisMotion(speed, accel, baseSpeed); }
+
+    /** The same angular settings at a resolution \p ratio times finer. */
+    AxisConfig scaled(double ratio) const;
+
+    /**
+     * The commands turning the settings \p current of \p axis into these:
+     * only the settings that differ, ordered so that the unit accepts every
+     * intermediate state (see MotionConfig::commandsFrom).
+     */
+    std::vector<std::string> commandsFrom(const Axis& axis, const AxisConfig& current) const;
+
+    bool operator==(const AxisConfig& other) const;
+    bool operator!=(const AxisConfig& other) const { return !(*this == other); }
+};
+
+/**
+ * The full motion configuration of the unit: the settings of both axes and
+ * the speed control mode.
+ */
+struct MotionConfig {
+    AxisConfig pan;
+    AxisConfig tilt;
+    CtrllMode ctrlMode;
+
+    MotionConfig() : ctrlMode(INDEP) {}
+
+    AxisConfig& axis(const Axis& axis) { return axis == TILT ? tilt : pan; }
+    const AxisConfig& axis(const Axis& axis) const { return axis == TILT ? tilt : pan; }
+
+    bool operator==(const MotionConfig& other) const;
+    bool operator!=(const MotionConfig& other) const { return !(*this == other); }
+
+    /**
+     * The commands turning the configuration \p current of the unit into
+     * this one: only the settings that differ, ordered so that the unit
+     * accepts every intermediate state. Speed limits are widened before and
+     * narrowed after the speeds change, and pure velocity mode is entered
+     * last and left first, so no speed change moves the head on the way.
+     */
+    std::vector<std::string> commandsFrom(const MotionConfig& current) const;
+
+    /** The queries reading a complete configuration, in the order parse() expects. */
+    static std::vector<std::string> queries();
+
+    /**
+     * Builds a configuration from the replies to queries().
+     * @throws std::runtime_error if the number of replies does not match
+     */
+    static MotionConfig parse(const std::vector<std::string>& replies);
+};
+
+/**
+ * A set of named motion configurations, e.g. "slew" and "tracking".
+ */
+class MotionConfigSet {
+private:
+    std::map<std::string, MotionConfig> mConfigs;
+
+public:
+    /** Adds or replaces the configuration \p name. */
+    void set(const std::string& name, const MotionConfig& config) { mConfigs[name] = config; }
+
+    /**
+     * The configuration \p name.
+     * @throws std::runtime_error if there is none
+     */
+    const MotionConfig& get(const std::string& name) const;
+
+    bool has(const std::string& name) const { return mConfigs.count(name) != 0; }
+
+    void remove(const std::string& name) { mConfigs.erase(name); }
+
+    /** The names of all configurations, sorted. */
+    std::vector<std::string> names() const;
+};
+
+} /* namespace ptu */
+
+#endif /* MOTION_CONFIG_H_ */
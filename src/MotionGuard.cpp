@@ -0,0 +1,346 @@
+/**
+  * Host-side soft limits and keep-out zones of the Pan-Tilt Unit.
+  * @file MotionGuard.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "MotionGuard.h"
+using namespace ptu;
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// Helpers
+//==============================================================================
+namespace {
+
+/** Cross product of (a - o) and (b - o), positive if o, a, b turn left. */
+double cross(const PanTiltRad& o, const PanTiltRad& a, const PanTiltRad& b) {
+    return (a.pan - o.pan) * (b.tilt - o.tilt) - (a.tilt - o.tilt) * (b.pan - o.pan);
+}
+
+/** True if \p p, known to be collinear with \p a and \p b, lies between them. */
+bool between(const PanTiltRad& a, const PanTiltRad& b, const PanTiltRad& p) {
+    return std::min(a.pan, b.pan) <= p.pan && p.pan <= std::max(a.pan, b.pan) &&
+           std::min(a.tilt, b.tilt) <= p.tilt && p.tilt <= std::max(a.tilt, b.tilt);
+}
+
+/** True if the segments p1-p2 and q1-q2 intersect or touch. */
+bool intersect(const PanTiltRad& p1, const PanTiltRad& p2, const PanTiltRad& q1, const PanTiltRad& q2) {
+    double d1 = cross(q1, q2, p1);
+    double d2 = cross(q1, q2, p2);
+    double d3 = cross(p1, p2, q1);
+    double d4 = cross(p1, p2, q2);
+
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))) {
+        return true;
+    }
+    return (d1 == 0 && between(q1, q2, p1)) || (d2 == 0 && between(q1, q2, p2)) ||
+           (d3 == 0 && between(p1, p2, q1)) || (d4 == 0 && between(p1, p2, q2));
+}
+
+/** Outward unit normal of the edge \p a - \p b of a polygon of \p orientation. */
+PanTiltRad normal(const PanTiltRad& a, const PanTiltRad& b, double orientation) {
+    double dp = b.pan - a.pan, dt = b.tilt - a.tilt;
+    double length = std::sqrt(dp * dp + dt * dt);
+    if (length == 0) {
+        return PanTiltRad();
+    }
+    return PanTiltRad(orientation * dt / length, -orientation * dp / length);
+}
+
+/** \p polygon with every edge moved outwards by \p distance, mitered. */
+MotionGuard::Polygon offset(const MotionGuard::Polygon& polygon, double distance) {
+    size_t n = polygon.size();
+
+    double area = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const PanTiltRad& a = polygon[i];
+        const PanTiltRad& b = polygon[(i + 1) % n];
+        area += a.pan * b.tilt - b.pan * a.tilt;
+    }
+    double orientation = area >= 0 ? 1 : -1;
+
+    MotionGuard::Polygon grown(n);
+    for (size_t i = 0; i < n; ++i) {
+        const PanTiltRad& prev = polygon[(i + n - 1) % n];
+        const PanTiltRad& vertex = polygon[i];
+        const PanTiltRad& next = polygon[(i + 1) % n];
+
+        PanTiltRad n1 = normal(prev, vertex, orientation);
+        PanTiltRad n2 = normal(vertex, next, orientation);
+        PanTiltRad bisector(n1.pan + n2.pan, n1.tilt + n2.tilt);
+
+        double length = std::sqrt(bisector.pan * bisector.pan + bisector.tilt * bisector.tilt);
+        if (length < 1e-9) {
+            bisector = n1;
+            length = 1;
+        }
+        bisector.pan /= length;
+        bisector.tilt /= length;
+
+        // the miter grows with sharper corners, limit it to 4 times the distance
+        double cosine = std::max(bisector.pan * n1.pan + bisector.tilt * n1.tilt, 0.25);
+        grown[i] = PanTiltRad(vertex.pan + bisector.pan * distance / cosine,
+                              vertex.tilt + bisector.tilt * distance / cosine);
+    }
+    return grown;
+}
+
+} /* namespace */
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+void MotionGuard::grow(Zone& zone) const {
+    zone.barrier = offset(zone.polygon, mClearance / 2);
+    zone.corners = offset(zone.polygon, mClearance);
+
+    zone.min = zone.max = zone.barrier[0];
+    for (size_t i = 1; i < zone.barrier.size(); ++i) {
+        zone.min.pan = std::min(zone.min.pan, zone.barrier[i].pan);
+        zone.min.tilt = std::min(zone.min.tilt, zone.barrier[i].tilt);
+        zone.max.pan = std::max(zone.max.pan, zone.barrier[i].pan);
+        zone.max.tilt = std::max(zone.max.tilt, zone.barrier[i].tilt);
+    }
+}
+
+bool MotionGuard::inside(const Polygon& polygon, const PanTiltRad& point) {
+    bool in = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const PanTiltRad& a = polygon[i];
+        const PanTiltRad& b = polygon[j];
+        if ((a.tilt > point.tilt) != (b.tilt > point.tilt) &&
+                point.pan < (b.pan - a.pan) * (point.tilt - a.tilt) / (b.tilt - a.tilt) + a.pan) {
+            in = !in;
+        }
+    }
+    return in;
+}
+
+bool MotionGuard::crosses(const Zone& zone, const PanTiltRad& a, const PanTiltRad& b) {
+    if (std::max(a.pan, b.pan) < zone.min.pan || std::min(a.pan, b.pan) > zone.max.pan ||
+            std::max(a.tilt, b.tilt) < zone.min.tilt || std::min(a.tilt, b.tilt) > zone.max.tilt) {
+        return false;
+    }
+
+    if (inside(zone.barrier, a) || inside(zone.barrier, b)) {
+        return true;
+    }
+
+    const Polygon& barrier = zone.barrier;
+    for (size_t i = 0; i < barrier.size(); ++i) {
+        if (intersect(a, b, barrier[i], barrier[(i + 1) % barrier.size()])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+MotionGuard::MotionGuard(double clearance) {
+    mLimited[PAN] = mLimited[TILT] = false;
+    setClearance(clearance);
+}
+
+void MotionGuard::setLimits(const Axis& axis, double min, double max) {
+    mLimited[axis == TILT ? TILT : PAN] = true;
+    (axis == TILT ? mMin.tilt : mMin.pan) = min;
+    (axis == TILT ? mMax.tilt : mMax.pan) = max;
+}
+
+void MotionGuard::setClearance(double clearance) {
+    if (clearance < 0) {
+        throw std::runtime_error("MotionGuard: the clearance must not be negative");
+    }
+
+    mClearance = clearance;
+    for (size_t i = 0; i < mZones.size(); ++i) {
+        grow(mZones[i]);
+    }
+}
+
+void MotionGuard::addZone(const Polygon& polygon) {
+    if (polygon.size() < 3) {
+        throw std::runtime_error("MotionGuard: a keep-out zone needs at least three vertices");
+    }
+
+    Zone zone;
+    zone.polygon = polygon;
+    grow(zone);
+    mZones.push_back(zone);
+}
+
+void MotionGuard::clearZones() {
+    mZones.clear();
+}
+
+bool MotionGuard::withinLimits(const PanTiltRad& position) const {
+    return (!mLimited[PAN] || (position.pan >= mMin.pan && position.pan <= mMax.pan)) &&
+           (!mLimited[TILT] || (position.tilt >= mMin.tilt && position.tilt <= mMax.tilt));
+}
+
+int MotionGuard::zoneAt(const PanTiltRad& position) const {
+    for (size_t i = 0; i < mZones.size(); ++i) {
+        if (inside(mZones[i].polygon, position)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void MotionGuard::validate(const Axis& axis, double target) const {
+    int index = axis == TILT ? TILT : PAN;
+    double min = index == TILT ? mMin.tilt : mMin.pan;
+    double max = index == TILT ? mMax.tilt : mMax.pan;
+
+    if (mLimited[index] && (target < min || target > max)) {
+        ostringstream msg;
+        msg << "MotionGuard: " << (index == TILT ? "tilt" : "pan") << " target " << target
+            << " rad is outside the limits [" << min << ", " << max << "]";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+void MotionGuard::validate(const PanTiltRad& target, bool checkPan) const {
+    if (checkPan) {
+        validate(PAN, target.pan);
+    }
+    validate(TILT, target.tilt);
+
+    if (!checkPan) {
+        return;
+    }
+
+    for (size_t i = 0; i < mZones.size(); ++i) {
+        if (inside(mZones[i].barrier, target)) {
+            ostringstream msg;
+            msg << "MotionGuard: target (" << target.pan << ", " << target.tilt
+                << ") rad is in keep-out zone " << i << " or within half its clearance";
+            throw std::runtime_error(msg.str());
+        }
+    }
+}
+
+bool MotionGuard::isClear(const PanTiltTicks& from, const PanTiltTicks& to,
+                          const Units& units, const MovePredictor& predictor) const {
+    PanTiltRad a = units.toRad(from);
+    PanTiltRad b = units.toRad(to);
+
+    // both axes move monotonically, so the path stays in the box of its ends;
+    // a head caught in a zone may leave it
+    vector<const Zone*> zones;
+    for (size_t i = 0; i < mZones.size(); ++i) {
+        const Zone& zone = mZones[i];
+        bool near = !(std::max(a.pan, b.pan) < zone.min.pan || std::min(a.pan, b.pan) > zone.max.pan ||
+                      std::max(a.tilt, b.tilt) < zone.min.tilt || std::min(a.tilt, b.tilt) > zone.max.tilt);
+        if (near && !inside(zone.barrier, a)) {
+            zones.push_back(&zone);
+        }
+    }
+    if (zones.empty()) {
+        return true;
+    }
+
+    int panDistance = to.pan - from.pan;
+    int tiltDistance = to.tilt - from.tilt;
+    double panRad = units.axis(PAN).ticksToRad(panDistance < 0 ? -1 : 1);
+    double tiltRad = units.axis(TILT).ticksToRad(tiltDistance < 0 ? -1 : 1);
+
+    // follow the modeled path in steps of 5ms
+    double duration = predictor.duration(from, to);
+    int steps = std::min(std::max(int(std::ceil(duration / 0.005)), 1), 512);
+
+    PanTiltRad prev = a;
+    for (int k = 1; k <= steps; ++k) {
+        double t = duration * k / steps;
+        PanTiltRad point = k == steps ? b :
+                PanTiltRad(a.pan + panRad * predictor.distanceAt(PAN, panDistance, t),
+                           a.tilt + tiltRad * predictor.distanceAt(TILT, tiltDistance, t));
+
+        for (size_t i = 0; i < zones.size(); ++i) {
+            if (crosses(*zones[i], prev, point)) {
+                return false;
+            }
+        }
+        prev = point;
+    }
+    return true;
+}
+
+vector<PanTiltTicks> MotionGuard::route(const PanTiltTicks& from, const PanTiltTicks& to,
+                                        const Units& units, const MovePredictor& predictor,
+                                        double* duration) const {
+    // nodes 0 and 1 are the ends, the others the corners that are usable
+    vector<PanTiltTicks> nodes;
+    nodes.push_back(from);
+    nodes.push_back(to);
+
+    for (size_t i = 0; i < mZones.size(); ++i) {
+        const Polygon& corners = mZones[i].corners;
+        for (size_t j = 0; j < corners.size(); ++j) {
+            bool usable = withinLimits(corners[j]);
+            for (size_t k = 0; k < mZones.size() && usable; ++k) {
+                usable = !inside(mZones[k].barrier, corners[j]);
+            }
+            if (usable) {
+                nodes.push_back(units.toTicks(corners[j]));
+            }
+        }
+    }
+
+    // Dijkstra on the complete graph, edges are only checked when they would help
+    const double infinity = std::numeric_limits<double>::infinity();
+    vector<double> time(nodes.size(), infinity);
+    vector<int> previous(nodes.size(), -1);
+    vector<bool> done(nodes.size(), false);
+    time[0] = 0;
+
+    while (true) {
+        int u = -1;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (!done[i] && time[i] < infinity && (u < 0 || time[i] < time[u])) {
+                u = i;
+            }
+        }
+        if (u < 0 || u == 1) {
+            break;
+        }
+        done[u] = true;
+
+        for (size_t v = 1; v < nodes.size(); ++v) {
+            if (done[v]) {
+                continue;
+            }
+            double t = time[u] + predictor.duration(nodes[u], nodes[v]);
+            if (t < time[v] && isClear(nodes[u], nodes[v], units, predictor)) {
+                time[v] = t;
+                previous[v] = u;
+            }
+        }
+    }
+
+    if (previous[1] < 0 && !(from.pan == to.pan && from.tilt == to.tilt)) {
+        throw std::runtime_error("MotionGuard: the keep-out zones leave no route to the target");
+    }
+
+    vector<PanTiltTicks> waypoints;
+    for (int node = 1; node > 0; node = previous[node]) {
+        waypoints.push_back(nodes[node]);
+    }
+    std::reverse(waypoints.begin(), waypoints.end());
+
+    if (duration != 0) {
+        *duration = time[1] < infinity ? time[1] : 0;
+    }
+    return waypoints;
+}
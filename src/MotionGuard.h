@@ -0,0 +1,132 @@
+/**
+  * Host-side soft limits and keep-out zones of the Pan-Tilt Unit.
+  * @file MotionGuard.h
+  */
+
+#ifndef MOTION_GUARD_H_
+#define MOTION_GUARD_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <vector>
+
+#include "MotionModel.h"
+#include "MovePredictor.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Checks targets against soft position limits and keep-out zones before they
+ * are sent, and routes moves around the zones.
+ *
+ * Zones are polygons in pan/tilt space (radians), e.g. the angles under
+ * which the camera would see the robot's own mast or a light source. The
+ * head must not stop in a zone nor pass through one.
+ *
+ * A coordinated move does not follow a straight line in pan/tilt space:
+ * both axes start together, but each runs its own trapezoidal profile
+ * (MotionModel), so the shorter axis arrives first. Moves are checked along
+ * that path, on the time scale calibrated by the MovePredictor, against the
+ * zones grown by half the clearance.
+ *
+ * Moves that would cross a zone are routed over a visibility graph whose
+ * nodes are the corners of the zones grown by the full clearance and whose
+ * edges are the clear moves between them, weighted by their predicted
+ * duration. The fastest route is returned as intermediate waypoints.
+ */
+class MotionGuard {
+public:
+    typedef std::vector<PanTiltRad> Polygon;
+
+private:
+    struct Zone {
+        Polygon polygon;        //!< as defined
+        Polygon barrier;        //!< grown by half the clearance, checked against
+        Polygon corners;        //!< grown by the clearance, route candidates
+        PanTiltRad min, max;    //!< bounding box of the barrier
+    };
+
+    bool mLimited[2];   //!< per axis, whether the soft limits are set
+    PanTiltRad mMin;
+    PanTiltRad mMax;
+    double mClearance;
+    std::vector<Zone> mZones;
+
+    /** Builds barrier, corners and bounding box of \p zone. */
+    void grow(Zone& zone) const;
+
+    /** True if the segment from \p a to \p b touches or enters \p zone. */
+    static bool crosses(const Zone& zone, const PanTiltRad& a, const PanTiltRad& b);
+
+    /** True if \p point is inside \p polygon. */
+    static bool inside(const Polygon& polygon, const PanTiltRad& point);
+
+public:
+    /** @param clearance distance in radians kept to the zones when routing */
+    explicit MotionGuard(double clearance = 0.02);
+
+    /** Sets the soft limits of \p axis. Without, its positions are not limited. */
+    void setLimits(const Axis& axis, double min, double max);
+
+    /** Sets the distance kept to the zones, in radians. */
+    void setClearance(double clearance);
+    double getClearance() const { return mClearance; }
+
+    /**
+     * Adds a keep-out zone.
+     * @param polygon at least three vertices, in either orientation
+     * @throws std::runtime_error if it has fewer
+     */
+    void addZone(const Polygon& polygon);
+
+    /** Removes all keep-out zones. */
+    void clearZones();
+
+    size_t getZoneCount() const { return mZones.size(); }
+    const Polygon& getZone(size_t index) const { return mZones.at(index).polygon; }
+
+    /** True if \p position is within the soft limits. */
+    bool withinLimits(const PanTiltRad& position) const;
+
+    /** The index of the zone containing \p position, -1 if none. */
+    int zoneAt(const PanTiltRad& position) const;
+
+    /**
+     * Rejects a target outside the soft limits or in a keep-out zone. With
+     * \p checkPan false, only the tilt limit is checked (continuous pan).
+     * @throws std::runtime_error naming the violated limit or zone
+     */
+    void validate(const PanTiltRad& target, bool checkPan = true) const;
+
+    /**
+     * Rejects a target of \p axis outside its soft limits.
+     * @throws std::runtime_error naming the violated limit
+     */
+    void validate(const Axis& axis, double target) const;
+
+    /**
+     * True if the coordinated move from \p from to \p to, as predicted by
+     * \p predictor, keeps out of all zones. Zones that contain \p from do
+     * not count, so a head caught in a zone can be moved out.
+     */
+    bool isClear(const PanTiltTicks& from, const PanTiltTicks& to,
+                 const Units& units, const MovePredictor& predictor) const;
+
+    /**
+     * The fastest sequence of clear moves from \p from to \p to.
+     * @param duration set to the predicted duration of the route, if not 0
+     * @return the waypoints after \p from, ending with \p to
+     * @throws std::runtime_error if the zones leave no way through
+     */
+    std::vector<PanTiltTicks> route(const PanTiltTicks& from, const PanTiltTicks& to,
+                                    const Units& units, const MovePredictor& predictor,
+                                    double* duration = 0) const;
+};
+
+} /* namespace ptu */
+
+#endif /* MOTION_GUARD_H_ */
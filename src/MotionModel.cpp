@@ -0,0 +1,77 @@
+/**
+  * Trapezoidal model of the Pan-Tilt Unit motion.
+  * @file MotionModel.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "MotionModel.h"
+using namespace ptu;
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+//==============================================================================
+// Implementation
+//==============================================================================
+MotionModel::Profile MotionModel::profile(const AxisMotion& motion, double distance) {
+    Profile p;
+    p.peakSpeed = std::max(motion.speed, 1.0);
+    p.baseSpeed = std::min(std::max(motion.baseSpeed, 0.0), p.peakSpeed);
+    p.accel = std::max(motion.accel, 0.0);
+
+    if (p.accel == 0) {
+        p.baseSpeed = p.peakSpeed;
+        p.rampTime = 0;
+        p.cruiseTime = distance / p.peakSpeed;
+        return p;
+    }
+
+    // distance covered while ramping from base to desired speed
+    double ramp = (p.peakSpeed * p.peakSpeed - p.baseSpeed * p.baseSpeed) / (2 * p.accel);
+
+    if (2 * ramp > distance) {
+        // triangular profile, peak speed reached half way
+        p.peakSpeed = std::sqrt(p.baseSpeed * p.baseSpeed + p.accel * distance);
+        ramp = distance / 2;
+    }
+
+    p.rampTime = (p.peakSpeed - p.baseSpeed) / p.accel;
+    p.cruiseTime = (distance - 2 * ramp) / p.peakSpeed;
+    return p;
+}
+
+double MotionModel::moveTime(const AxisMotion& motion, int distance) {
+    if (distance == 0) {
+        return 0;
+    }
+
+    Profile p = profile(motion, std::abs(distance));
+    return 2 * p.rampTime + p.cruiseTime;
+}
+
+double MotionModel::distanceAt(const AxisMotion& motion, int distance, double seconds) {
+    double d = std::abs(distance);
+    if (d == 0 || seconds <= 0) {
+        return 0;
+    }
+
+    Profile p = profile(motion, d);
+    double ramp = p.baseSpeed * p.rampTime + p.accel * p.rampTime * p.rampTime / 2;
+
+    if (seconds < p.rampTime) {
+        return p.baseSpeed * seconds + p.accel * seconds * seconds / 2;
+    }
+    if (seconds < p.rampTime + p.cruiseTime) {
+        return ramp + p.peakSpeed * (seconds - p.rampTime);
+    }
+
+    double t = std::min(seconds - p.rampTime - p.cruiseTime, p.rampTime);
+    return std::min(d, d - ramp + p.peakSpeed * t - p.accel * t * t / 2);
+}
+
+double MotionModel::moveTime(const PanTiltTicks& from, const PanTiltTicks& to) const {
+    return std::max(moveTime(mPan, to.pan - from.pan), moveTime(mTilt, to.tilt - from.tilt));
+}
@@ -0,0 +1,83 @@
+/**
+  * Trapezoidal model of the Pan-Tilt Unit motion.
+  * @file MotionModel.h
+  */
+
+#ifndef MOTION_MODEL_H_
+#define MOTION_MODEL_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "Units.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Motion parameters of one axis, in positions/sec and positions/sec^2.
+ */
+struct AxisMotion {
+    double speed;       //!< desired (top) speed
+    double accel;       //!< desired acceleration
+    double baseSpeed;   //!< speed the axis starts and stops at
+
+    AxisMotion(double s = 1000, double a = 2000, double b = 0) :
+        speed(s), accel(a), baseSpeed(b) {}
+};
+
+/**
+ * Predicts move durations from the per-axis motion parameters.
+ *
+ * An axis jumps to its base speed, ramps up to its desired speed with the
+ * desired acceleration, cruises and ramps back down. Short moves never reach
+ * the desired speed and have a triangular profile. Both axes move at once, so
+ * a pan/tilt move lasts as long as its slowest axis.
+ */
+class MotionModel {
+private:
+    AxisMotion mPan;
+    AxisMotion mTilt;
+
+    /** Trapezoidal velocity profile of a single move. */
+    struct Profile {
+        double baseSpeed;   //!< speed at the start and the end
+        double peakSpeed;   //!< the desired speed, lower for short moves
+        double accel;       //!< 0 for a move at constant speed
+        double rampTime;    //!< duration of each of the two ramps
+        double cruiseTime;  //!< duration at the peak speed
+    };
+
+    /** The profile of a move of \p distance positions with \p motion. */
+    static Profile profile(const AxisMotion& motion, double distance);
+
+public:
+    MotionModel() {}
+    MotionModel(const AxisMotion& pan, const AxisMotion& tilt) : mPan(pan), mTilt(tilt) {}
+
+    const AxisMotion& axis(const Axis& axis) const { return axis == TILT ? mTilt : mPan; }
+    AxisMotion& axis(const Axis& axis) { return axis == TILT ? mTilt : mPan; }
+
+    /** Duration in seconds of a move of \p distance positions with \p motion. */
+    static double moveTime(const AxisMotion& motion, int distance);
+
+    /**
+     * Positions covered after \p seconds of a move of \p distance positions
+     * with \p motion, between 0 and the absolute distance.
+     */
+    static double distanceAt(const AxisMotion& motion, int distance, double seconds);
+
+    /** Duration in seconds of a move of \p distance positions on \p axis. */
+    double moveTime(const Axis& axis, int distance) const {
+        return moveTime(this->axis(axis), distance);
+    }
+
+    /** Duration in seconds of a coordinated move from \p from to \p to. */
+    double moveTime(const PanTiltTicks& from, const PanTiltTicks& to) const;
+};
+
+} /* namespace ptu */
+
+#endif /* MOTION_MODEL_H_ */
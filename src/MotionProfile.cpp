@@ -0,0 +1,234 @@
+/**
+  * Per-move selection of the motion profile (speed, acceleration, base speed).
+  * @file MotionProfile.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "MotionProfile.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+using namespace std;
+
+//==============================================================================
+// AxisCapability
+//==============================================================================
+double AxisCapability::accelAt(double speed) const {
+    if (stallSpeed <= 0) {
+        return accel;
+    }
+    return accel * std::max(0.0, 1.0 - speed / stallSpeed);
+}
+
+CharacterizationOptions::CharacterizationOptions() :
+        distance(2000),
+        repetitions(3),
+        startAccel(500),
+        accelStep(1.5),
+        maxAccel(20000)
+{
+    speeds.push_back(500);
+    speeds.push_back(1000);
+    speeds.push_back(2000);
+}
+
+//==============================================================================
+// ProfileTuner
+//==============================================================================
+ProfileTuner::ProfileTuner(const AxisCapability& pan, const AxisCapability& tilt, double stallMargin) :
+        mPan(pan),
+        mTilt(tilt),
+        mStallMargin(0),
+        mSpeedSteps(16),
+        mHysteresis(0.02)
+{
+    setStallMargin(stallMargin);
+}
+
+void ProfileTuner::setCapability(const Axis& axis, const AxisCapability& capability) {
+    if (axis == TILT) {
+        mTilt = capability;
+    } else {
+        mPan = capability;
+    }
+}
+
+void ProfileTuner::setStallMargin(double margin) {
+    if (margin < 0 || margin >= 1) {
+        throw std::runtime_error("ProfileTuner: stall margin must be in [0, 1)");
+    }
+    mStallMargin = margin;
+}
+
+AxisMotion ProfileTuner::select(const Axis& axis, int distance) const {
+    const AxisCapability& cap = capability(axis);
+
+    double maxSpeed = cap.maxSpeed * usable();
+    double baseSpeed = std::min(cap.maxBaseSpeed * usable(), maxSpeed);
+
+    // a lower top speed leaves more torque to accelerate with; at or beyond
+    // the stall speed none is left, and accel 0 would model an instant ramp
+    AxisMotion best;
+    double bestTime = std::numeric_limits<double>::infinity();
+
+    for (size_t i = 0; i <= mSpeedSteps; ++i) {
+        double speed = baseSpeed + (maxSpeed - baseSpeed) * i / mSpeedSteps;
+        AxisMotion candidate(speed, cap.accelAt(speed) * usable(), std::min(baseSpeed, speed));
+
+        if (candidate.accel <= 0) {
+            continue;
+        }
+
+        double time = MotionModel::moveTime(candidate, distance);
+        if (time < bestTime) {
+            best = candidate;
+            bestTime = time;
+        }
+    }
+
+    if (bestTime == std::numeric_limits<double>::infinity()) {
+        throw std::runtime_error("ProfileTuner: no usable profile, the stall speed is at or below the base speed");
+    }
+
+    best.speed = int(best.speed);
+    best.accel = int(best.accel);
+    best.baseSpeed = int(best.baseSpeed);
+    return best;
+}
+
+AxisMotion ProfileTuner::select(const Axis& axis, int distance, const AxisMotion& current) const {
+    AxisMotion best = select(axis, distance);
+
+    // the current profile is only kept if it is still safe to use
+    const AxisCapability& cap = capability(axis);
+    bool safe = current.speed <= cap.maxSpeed * usable() &&
+                current.accel <= cap.accelAt(current.speed) * usable() &&
+                current.baseSpeed <= cap.maxBaseSpeed * usable();
+
+    if (safe && MotionModel::moveTime(current, distance) <=
+            MotionModel::moveTime(best, distance) * (1 + mHysteresis)) {
+        return current;
+    }
+
+    return best;
+}
+
+bool ProfileTuner::move(Driver& driver, const PanTiltTicks& from, const PanTiltTicks& to,
+                        bool awaitCompletion) const
+{
+    MotionModel current = driver.getMotionModel();
+
+    driver.applyMotion(PAN, select(PAN, to.pan - from.pan, current.axis(PAN)));
+    driver.applyMotion(TILT, select(TILT, to.tilt - from.tilt, current.axis(TILT)));
+
+    return driver.setPos(to, awaitCompletion);
+}
+
+bool ProfileTuner::move(Driver& driver, const PanTiltTicks& to, bool awaitCompletion) const {
+    PanTiltTicks from(driver.getPos(PAN, false), driver.getPos(TILT, false));
+    return move(driver, from, to, awaitCompletion);
+}
+
+AxisCapability ProfileTuner::characterize(Driver& driver, const Axis& axis, StepReference& reference,
+                                          const CharacterizationOptions& options)
+{
+    AxisMotion saved = driver.queryMotionModel().axis(axis);
+    int start = driver.getPos(axis, false);
+
+    if (!reference.isAt(axis, start)) {
+        throw std::runtime_error("characterize: the reference does not confirm the start position");
+    }
+
+    // move towards the side with room left
+    float maxRad = axis == PAN ? driver.getMaxPanRad() : driver.getMaxTiltRad();
+    int far = start + options.distance <= driver.getUnits().axis(axis).radToTicks(maxRad)
+            ? start + options.distance : start - options.distance;
+
+    vector<pair<double, double> > followed;
+
+    try {
+        for (size_t i = 0; i < options.speeds.size(); ++i) {
+            double speed = options.speeds[i];
+            double best = 0;
+
+            for (double accel = options.startAccel; accel <= options.maxAccel; accel *= options.accelStep) {
+                AxisMotion motion(speed, accel, std::min(saved.baseSpeed, speed));
+                driver.applyMotion(axis, motion);
+
+                for (size_t k = 0; k < options.repetitions; ++k) {
+                    driver.setPos(axis, false, far, true);
+                    driver.setPos(axis, false, start, true);
+                }
+
+                bool kept = reference.isAt(axis, start);
+                LOG_DEBUG_S << "characterize: speed " << speed << " accel " << accel
+                            << (kept ? " kept all steps" : " lost steps");
+
+                if (!kept) {
+                    // the step counter is off now, home it at a safe profile
+                    driver.applyMotion(axis, saved);
+                    driver.reset(axis == PAN, axis == TILT);
+                    driver.setPos(axis, false, start, true);
+                    break;
+                }
+                best = accel;
+            }
+
+            if (best > 0) {
+                followed.push_back(make_pair(speed, best));
+            }
+        }
+    } catch (...) {
+        // leave the axis as found; the original error matters more than a
+        // failing restore
+        try {
+            driver.applyMotion(axis, saved);
+            driver.setPos(axis, false, start, true);
+        } catch (std::exception& e) {
+            LOG_ERROR_S << "characterize: cannot restore the motion profile: " << e.what();
+        }
+        throw;
+    }
+
+    driver.applyMotion(axis, saved);
+    driver.setPos(axis, false, start, true);
+
+    if (followed.empty()) {
+        throw std::runtime_error("characterize: the axis lost steps with every tested profile");
+    }
+
+    AxisCapability result(followed[0].second, 0, followed.back().first, saved.baseSpeed);
+
+    // least squares line through (speed, accel)
+    if (followed.size() >= 2) {
+        double n = followed.size(), sv = 0, sa = 0, svv = 0, sva = 0;
+        for (size_t i = 0; i < followed.size(); ++i) {
+            sv += followed[i].first;
+            sa += followed[i].second;
+            svv += followed[i].first * followed[i].first;
+            sva += followed[i].first * followed[i].second;
+        }
+
+        double den = n * svv - sv * sv;
+        double slope = den != 0 ? (n * sva - sv * sa) / den : 0;
+        double offset = (sa - slope * sv) / n;
+
+        if (slope < 0 && offset > 0) {
+            result.accel = offset;
+            result.stallSpeed = -offset / slope;
+        } else {
+            result.accel = sa / n;
+        }
+    }
+
+    LOG_INFO_S << "characterize: accel " << result.accel << " stall speed " << result.stallSpeed
+               << " max speed " << result.maxSpeed;
+    return result;
+}
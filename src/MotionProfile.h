@@ -0,0 +1,164 @@
+/**
+  * Per-move selection of the motion profile (speed, acceleration, base speed).
+  * @file MotionProfile.h
+  */
+
+#ifndef MOTION_PROFILE_H_
+#define MOTION_PROFILE_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <vector>
+
+#include "MotionModel.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+class Driver;
+
+/**
+ * What an axis of the attached unit can do with its current payload.
+ *
+ * Stepper torque drops with speed, so the achievable acceleration is modeled
+ * as falling linearly from \c accel at standstill to zero at \c stallSpeed.
+ * Speeds are in positions/sec, accelerations in positions/sec^2.
+ */
+struct AxisCapability {
+    double accel;           //!< achievable acceleration at low speed
+    double stallSpeed;      //!< speed at which no acceleration is left, 0 if unknown
+    double maxSpeed;        //!< highest usable top speed
+    double maxBaseSpeed;    //!< highest base speed the axis starts at reliably
+
+    AxisCapability(double a = 2000, double stall = 0, double speed = 2000, double base = 100) :
+        accel(a), stallSpeed(stall), maxSpeed(speed), maxBaseSpeed(base) {}
+
+    /** Achievable acceleration when cruising at \p speed. */
+    double accelAt(double speed) const;
+};
+
+/**
+ * Tells whether an axis physically is where the unit believes it is.
+ *
+ * The unit counts the steps it commands, not the ones the motor makes: when
+ * an open-loop stepper stalls, position queries and awaited moves complete
+ * as if nothing happened. Only a reference outside the step counter, e.g. a
+ * camera watching a fiducial, an encoder or an index mark, notices lost
+ * steps.
+ */
+class StepReference {
+public:
+    virtual ~StepReference() {}
+
+    /** True if \p axis physically is at \p position, as far as the reference can tell. */
+    virtual bool isAt(const Axis& axis, int position) = 0;
+};
+
+/**
+ * Options of ProfileTuner::characterize.
+ */
+struct CharacterizationOptions {
+    int distance;                   //!< length of the test moves, in positions
+    size_t repetitions;             //!< back and forth moves per tested profile
+    std::vector<double> speeds;     //!< top speeds to test, in positions/sec
+    double startAccel;              //!< first acceleration tried at each speed
+    double accelStep;               //!< factor between successive accelerations
+    double maxAccel;                //!< highest acceleration tried
+
+    CharacterizationOptions();
+};
+
+/**
+ * Picks the acceleration, base speed and top speed of every move from its
+ * distance, and only sends the parameters that differ from what the unit
+ * currently uses.
+ *
+ * Short hops never reach top speed, so they get the highest acceleration
+ * and base speed; long slews get the top speed that minimizes the predicted
+ * time given that acceleration drops with speed. A stall margin, to be
+ * raised with the payload, keeps a fraction of the capability in reserve.
+ */
+class ProfileTuner {
+private:
+    AxisCapability mPan;
+    AxisCapability mTilt;
+    double mStallMargin;
+    size_t mSpeedSteps;
+    double mHysteresis;
+
+    /** Usable fraction of the capability. */
+    double usable() const { return 1.0 - mStallMargin; }
+
+public:
+    /**
+     * @param pan capability of the pan axis
+     * @param tilt capability of the tilt axis
+     * @param stallMargin fraction of the capability kept in reserve, in [0, 1)
+     */
+    ProfileTuner(const AxisCapability& pan, const AxisCapability& tilt, double stallMargin = 0.2);
+
+    const AxisCapability& capability(const Axis& axis) const { return axis == TILT ? mTilt : mPan; }
+    void setCapability(const Axis& axis, const AxisCapability& capability);
+
+    /** Fraction of the capability kept in reserve, higher for heavier payloads. */
+    void setStallMargin(double margin);
+    double getStallMargin() const { return mStallMargin; }
+
+    /**
+     * Relative time gain below which the current profile is kept rather
+     * than sending a new one, 0.02 by default.
+     */
+    void setHysteresis(double gain) { mHysteresis = gain; }
+
+    /**
+     * The fastest profile for a move of \p distance positions on \p axis.
+     * Top speeds at or beyond the stall speed are never selected.
+     * @throws std::runtime_error if the capability leaves no acceleration
+     *         at any speed from the base speed up
+     */
+    AxisMotion select(const Axis& axis, int distance) const;
+
+    /**
+     * The profile to use for a move of \p distance positions when the unit
+     * currently runs \p current: the fastest one, unless it is not faster
+     * than \p current by at least the hysteresis.
+     */
+    AxisMotion select(const Axis& axis, int distance, const AxisMotion& current) const;
+
+    /**
+     * Tunes both axes for the move from \p from to \p to, sending only the
+     * changed parameters, then moves.
+     * @return the result of Driver::setPos
+     */
+    bool move(Driver& driver, const PanTiltTicks& from, const PanTiltTicks& to,
+              bool awaitCompletion = true) const;
+
+    /** Like move(), starting from the position queried from the unit. */
+    bool move(Driver& driver, const PanTiltTicks& to, bool awaitCompletion = true) const;
+
+    /**
+     * Measures the capability of \p axis on the attached unit. For every
+     * test speed, the axis moves back and forth with growing accelerations
+     * until \p reference no longer finds it at its start position, i.e. it
+     * lost steps. The axis is then homed (Driver::reset) and sent back to
+     * the start. A line is fitted through the highest accelerations that
+     * kept all steps.
+     *
+     * The axis moves by up to \p options.distance positions from its current
+     * position, towards the side within the position limits; the motion
+     * parameters and the position are restored afterwards, also when a
+     * command fails. The reference only samples the start position, so keep
+     * a stall margin on the result.
+     * @throws std::runtime_error if \p reference does not confirm the start
+     *         position before the first test move
+     */
+    static AxisCapability characterize(Driver& driver, const Axis& axis, StepReference& reference,
+            const CharacterizationOptions& options = CharacterizationOptions());
+};
+
+} /* namespace ptu */
+
+#endif /* MOTION_PROFILE_H_ */
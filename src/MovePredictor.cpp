@@ -0,0 +1,127 @@
+/**
+  * Self-calibrating prediction of move durations and arrival times.
+  * @file MovePredictor.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "MovePredictor.h"
+using namespace ptu;
+
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// Private static methods implementation
+//==============================================================================
+void MovePredictor::resetCalibration(AxisTiming& timing) {
+    timing.scale = 1;
+    timing.offset = 0;
+    timing.sw = timing.sx = timing.sy = timing.sxx = timing.sxy = 0;
+    timing.samples = 0;
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+MovePredictor::MovePredictor(const MotionModel& model, double forgetting) :
+        mForgetting(forgetting)
+{
+    if (forgetting <= 0 || forgetting > 1) {
+        throw std::runtime_error("MovePredictor: forgetting factor must be in (0, 1]");
+    }
+
+    setMotionModel(model);
+    resetCalibration();
+}
+
+void MovePredictor::setMotionModel(const MotionModel& model) {
+    mAxes[PAN].motion = model.axis(PAN);
+    mAxes[TILT].motion = model.axis(TILT);
+}
+
+double MovePredictor::duration(const PanTiltTicks& from, const PanTiltTicks& to) const {
+    return std::max(calibratedTime(mAxes[PAN], to.pan - from.pan),
+                    calibratedTime(mAxes[TILT], to.tilt - from.tilt));
+}
+
+double MovePredictor::distanceAt(const Axis& axis, int distance, double seconds) const {
+    const AxisTiming& timing = mAxes[axis == TILT ? TILT : PAN];
+    return MotionModel::distanceAt(timing.motion, distance, (seconds - timing.offset) / timing.scale);
+}
+
+MovePrediction MovePredictor::predict(const PanTiltTicks& from, const PanTiltTicks& to,
+                                      const base::Time& start) const
+{
+    MovePrediction prediction;
+    prediction.panDuration = calibratedTime(mAxes[PAN], to.pan - from.pan);
+    prediction.tiltDuration = calibratedTime(mAxes[TILT], to.tilt - from.tilt);
+    prediction.duration = std::max(prediction.panDuration, prediction.tiltDuration);
+
+    prediction.panArrival = start + base::Time::fromSeconds(prediction.panDuration);
+    prediction.tiltArrival = start + base::Time::fromSeconds(prediction.tiltDuration);
+    prediction.arrival = start + base::Time::fromSeconds(prediction.duration);
+    return prediction;
+}
+
+void MovePredictor::predict(const PanTiltTicks& from, const vector<PanTiltTicks>& targets,
+                            vector<double>& durations) const
+{
+    const AxisTiming& pan = mAxes[PAN];
+    const AxisTiming& tilt = mAxes[TILT];
+
+    durations.resize(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        durations[i] = std::max(calibratedTime(pan, targets[i].pan - from.pan),
+                                calibratedTime(tilt, targets[i].tilt - from.tilt));
+    }
+}
+
+void MovePredictor::observe(const Axis& axis, int distance, double seconds) {
+    if (distance == 0) {
+        return;
+    }
+
+    AxisTiming& timing = mAxes[axis == TILT ? TILT : PAN];
+    double x = MotionModel::moveTime(timing.motion, distance);
+    double y = seconds;
+
+    timing.sw = mForgetting * timing.sw + 1;
+    timing.sx = mForgetting * timing.sx + x;
+    timing.sy = mForgetting * timing.sy + y;
+    timing.sxx = mForgetting * timing.sxx + x * x;
+    timing.sxy = mForgetting * timing.sxy + x * y;
+    ++timing.samples;
+
+    double den = timing.sw * timing.sxx - timing.sx * timing.sx;
+
+    if (timing.samples >= 3 && den > 1e-9 * timing.sw * timing.sxx) {
+        double scale = (timing.sw * timing.sxy - timing.sx * timing.sy) / den;
+        if (scale > 0) {
+            timing.scale = scale;
+            timing.offset = (timing.sy - scale * timing.sx) / timing.sw;
+            return;
+        }
+    }
+
+    // too few or too similar samples for a line, only correct the scale
+    if (timing.sx > 0) {
+        timing.scale = timing.sy / timing.sx;
+        timing.offset = 0;
+    }
+}
+
+void MovePredictor::observe(const PanTiltTicks& from, const PanTiltTicks& to, double seconds) {
+    if (calibratedTime(mAxes[PAN], to.pan - from.pan) >= calibratedTime(mAxes[TILT], to.tilt - from.tilt)) {
+        observe(PAN, to.pan - from.pan, seconds);
+    } else {
+        observe(TILT, to.tilt - from.tilt, seconds);
+    }
+}
+
+void MovePredictor::resetCalibration() {
+    resetCalibration(mAxes[PAN]);
+    resetCalibration(mAxes[TILT]);
+}
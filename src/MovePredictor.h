@@ -0,0 +1,135 @@
+/**
+  * Self-calibrating prediction of move durations and arrival times.
+  * @file MovePredictor.h
+  */
+
+#ifndef MOVE_PREDICTOR_H_
+#define MOVE_PREDICTOR_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <vector>
+
+#include <base/Time.hpp>
+
+#include "MotionModel.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Expected outcome of a pan/tilt move.
+ */
+struct MovePrediction {
+    double panDuration;     //!< seconds until the pan axis arrives
+    double tiltDuration;    //!< seconds until the tilt axis arrives
+    double duration;        //!< seconds until both axes arrived
+    base::Time panArrival;
+    base::Time tiltArrival;
+    base::Time arrival;
+};
+
+/**
+ * Predicts how long moves take from the trapezoidal MotionModel, corrected
+ * per axis by a linear calibration fitted to observed completion times.
+ *
+ * The calibration maps the model duration t to scale * t + offset, where the
+ * offset absorbs command latency and the scale systematic profile errors.
+ * Where a negative offset would make that negative, scale * t is used.
+ * It is fitted by exponentially weighted least squares, so it follows slow
+ * drift (payload, temperature) while old samples fade out.
+ *
+ * A prediction costs a few multiplications and at most one square root per
+ * axis; evaluating thousands of candidate targets per planning cycle is
+ * cheap.
+ */
+class MovePredictor {
+private:
+    struct AxisTiming {
+        AxisMotion motion;
+
+        // calibration
+        double scale;
+        double offset;
+        double sw, sx, sy, sxx, sxy;   //!< weighted least squares sums
+        size_t samples;
+    };
+
+    AxisTiming mAxes[2];
+    double mForgetting;
+
+    static void resetCalibration(AxisTiming& timing);
+
+    static double calibratedTime(const AxisTiming& timing, int distance) {
+        if (distance == 0) {
+            return 0;
+        }
+        // a negative fitted offset must not make short moves take no time
+        double scaled = timing.scale * MotionModel::moveTime(timing.motion, distance);
+        return scaled + timing.offset > 0 ? scaled + timing.offset : scaled;
+    }
+
+public:
+    /**
+     * @param model the motion parameters of the unit
+     * @param forgetting weight kept by older samples at each new sample, in (0, 1]
+     */
+    explicit MovePredictor(const MotionModel& model = MotionModel(), double forgetting = 0.95);
+
+    /** Updates the motion parameters, keeping the calibration. */
+    void setMotionModel(const MotionModel& model);
+
+    /** The motion parameters the predictions are based on. */
+    MotionModel getMotionModel() const { return MotionModel(mAxes[PAN].motion, mAxes[TILT].motion); }
+
+    /** Predicted duration in seconds of a move of \p distance positions on \p axis. */
+    double duration(const Axis& axis, int distance) const {
+        return calibratedTime(mAxes[axis == TILT ? TILT : PAN], distance);
+    }
+
+    /** Predicted duration in seconds of the coordinated move from \p from to \p to. */
+    double duration(const PanTiltTicks& from, const PanTiltTicks& to) const;
+
+    /**
+     * Positions covered after \p seconds of a move of \p distance positions
+     * on \p axis: MotionModel::distanceAt() on the calibrated time scale.
+     */
+    double distanceAt(const Axis& axis, int distance, double seconds) const;
+
+    /**
+     * Predicts the coordinated move from \p from to \p to started at \p start.
+     */
+    MovePrediction predict(const PanTiltTicks& from, const PanTiltTicks& to,
+            const base::Time& start = base::Time::now()) const;
+
+    /**
+     * Predicts the durations of the moves from \p from to each of \p targets.
+     */
+    void predict(const PanTiltTicks& from, const std::vector<PanTiltTicks>& targets,
+            std::vector<double>& durations) const;
+
+    /**
+     * Feeds an observed move of \p distance positions on \p axis that took
+     * \p seconds into the calibration.
+     */
+    void observe(const Axis& axis, int distance, double seconds);
+
+    /**
+     * Feeds an observed coordinated move. The observed time is attributed to
+     * the axis predicted to arrive last.
+     */
+    void observe(const PanTiltTicks& from, const PanTiltTicks& to, double seconds);
+
+    /** Drops all calibration samples. */
+    void resetCalibration();
+
+    double getScale(const Axis& axis) const { return mAxes[axis == TILT ? TILT : PAN].scale; }
+    double getOffset(const Axis& axis) const { return mAxes[axis == TILT ? TILT : PAN].offset; }
+};
+
+} /* namespace ptu */
+
+#endif /* MOVE_PREDICTOR_H_ */
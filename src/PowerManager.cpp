@@ -0,0 +1,181 @@
+/**
+  * Hold/move power management with a thermal load estimate.
+  * @file PowerManager.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "PowerManager.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <cmath>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// PowerOptions
+//==============================================================================
+PowerOptions::PowerOptions() :
+        idleHold(POWER_LOW),
+        move(POWER_REGULAR),
+        boost(POWER_HIGH),
+        boostAccel(3000),
+        boostSpeed(3000),
+        timeConstant(600),
+        limit(1.0)
+{
+    load[POWER_OFF] = 0;
+    load[POWER_LOW] = 0.35;
+    load[POWER_REGULAR] = 1.0;
+    load[POWER_HIGH] = 1.6;
+}
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+double PowerManager::heat(double load, PowerLevel level, double seconds) const {
+    double target = mOptions.load[level];
+    return target + (load - target) * exp(-seconds / mOptions.timeConstant);
+}
+
+void PowerManager::advance(AxisState& state, const base::Time& now) const {
+    if (!state.moveEnd.isNull() && state.moveEnd <= now) {
+        state.load = heat(state.load, state.level, (state.moveEnd - state.time).toSeconds());
+        state.time = state.moveEnd;
+        state.level = mOptions.idleHold;
+        state.moveEnd = base::Time();
+    }
+
+    if (state.time < now) {
+        state.load = heat(state.load, state.level, (now - state.time).toSeconds());
+        state.time = now;
+    }
+}
+
+PowerLevel PowerManager::select(const AxisState& state, const AxisMotion& motion, double seconds) const {
+    bool aggressive = motion.accel > mOptions.boostAccel || motion.speed > mOptions.boostSpeed;
+
+    if (aggressive && heat(state.load, mOptions.boost, seconds) <= mOptions.limit) {
+        return mOptions.boost;
+    }
+    return mOptions.move;
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+PowerManager::PowerManager(const PowerOptions& options) {
+    setOptions(options);
+
+    base::Time now = base::Time::now();
+    for (int i = 0; i < 2; ++i) {
+        mAxes[i].load = 0;
+        mAxes[i].time = now;
+        mAxes[i].level = options.idleHold;
+        mAxes[i].holdSent = -1;
+        mAxes[i].moveSent = -1;
+    }
+}
+
+void PowerManager::setOptions(const PowerOptions& options) {
+    if (options.idleHold == POWER_HIGH || options.move == POWER_OFF || options.boost == POWER_OFF) {
+        throw std::runtime_error("PowerManager: invalid hold or move power level");
+    }
+    if (options.timeConstant <= 0) {
+        throw std::runtime_error("PowerManager: the time constant must be positive");
+    }
+
+    boost::mutex::scoped_lock lock(mMutex);
+    mOptions = options;
+}
+
+void PowerManager::apply(Driver& driver) {
+    PowerOptions options;
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        options = mOptions;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        Axis axis = i == 0 ? PAN : TILT;
+        driver.setHoldPower(axis, options.idleHold);
+        driver.setMovePower(axis, options.move);
+
+        boost::mutex::scoped_lock lock(mMutex);
+        mAxes[i].holdSent = options.idleHold;
+        mAxes[i].moveSent = options.move;
+    }
+}
+
+bool PowerManager::move(Driver& driver, const PanTiltTicks& target, bool awaitCompletion) {
+    MovePrediction prediction = driver.predictMove(target);
+    MotionModel model = driver.getMotionModel();
+    double durations[2] = { prediction.panDuration, prediction.tiltDuration };
+
+    PowerLevel hold[2], move[2];
+    bool sendHold[2], sendMove[2];
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        base::Time now = base::Time::now();
+
+        for (int i = 0; i < 2; ++i) {
+            AxisState& state = mAxes[i];
+            advance(state, now);
+
+            hold[i] = mOptions.idleHold;
+            move[i] = durations[i] > 0 ? select(state, model.axis(i == 0 ? PAN : TILT), durations[i])
+                                       : PowerLevel(state.moveSent < 0 ? mOptions.move : state.moveSent);
+            sendHold[i] = state.holdSent != hold[i];
+            sendMove[i] = state.moveSent != move[i];
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        Axis axis = i == 0 ? PAN : TILT;
+        if (sendHold[i]) {
+            driver.setHoldPower(axis, hold[i]);
+        }
+        if (sendMove[i]) {
+            driver.setMovePower(axis, move[i]);
+        }
+
+        boost::mutex::scoped_lock lock(mMutex);
+        mAxes[i].holdSent = hold[i];
+        mAxes[i].moveSent = move[i];
+    }
+
+    // only a move that went out heats the axes
+    base::Time start = base::Time::now();
+    bool done = driver.setPos(target, awaitCompletion);
+
+    boost::mutex::scoped_lock lock(mMutex);
+    for (int i = 0; i < 2; ++i) {
+        if (durations[i] > 0) {
+            AxisState& state = mAxes[i];
+            advance(state, start);
+            state.level = move[i];
+            state.moveEnd = state.time + base::Time::fromSeconds(durations[i]);
+        }
+    }
+
+    return done;
+}
+
+double PowerManager::getLoad(const Axis& axis) const {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    AxisState state = mAxes[axis == TILT ? TILT : PAN];
+    advance(state, base::Time::now());
+    return state.load;
+}
+
+void PowerManager::invalidate() {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    for (int i = 0; i < 2; ++i) {
+        mAxes[i].holdSent = -1;
+        mAxes[i].moveSent = -1;
+    }
+}
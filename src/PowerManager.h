@@ -0,0 +1,112 @@
+/**
+  * Hold/move power management with a thermal load estimate.
+  * @file PowerManager.h
+  */
+
+#ifndef POWER_MANAGER_H_
+#define POWER_MANAGER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <boost/thread/mutex.hpp>
+#include <base/Time.hpp>
+
+#include "MotionModel.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+class Driver;
+
+/**
+ * Options of the PowerManager. Loads are relative heating rates: running an
+ * axis continuously at a level heats it towards its load, and moving at
+ * regular power all the time settles at 1.
+ */
+struct PowerOptions {
+    PowerLevel idleHold;    //!< hold power between moves, LOW by default
+    PowerLevel move;        //!< move power of ordinary moves
+    PowerLevel boost;       //!< move power of aggressive moves
+    double boostAccel;      //!< accelerations above this (positions/sec^2) are aggressive
+    double boostSpeed;      //!< speeds above this (positions/sec) are aggressive
+    double load[4];         //!< relative heating per PowerLevel
+    double timeConstant;    //!< thermal time constant of the motors, in seconds
+    double limit;           //!< highest load a boost may lead to
+
+    PowerOptions();
+};
+
+/**
+ * Sets hold and move power per axis around every move: the axes hold at low
+ * power between moves, and moves whose profile is aggressive get boosted
+ * move power as long as the thermal budget allows.
+ *
+ * The thermal load of each axis is estimated by a first order model: while
+ * the axis runs at a power level, its load approaches the load of that level
+ * exponentially with the time constant of the motors. A boost is only
+ * granted if the load at the predicted end of the move stays below the
+ * limit, so the cool-down at low hold power between moves pays for the
+ * boosts and fast schedules can run continuously; when the budget is spent,
+ * moves fall back to regular power instead of being slowed down.
+ *
+ * Only moves sent through move() are counted. Moves sent directly with
+ * Driver::setPos or by the ScanExecutor and WaypointExecutor heat the axes
+ * unseen, so the estimate is too low and boosts are granted too freely;
+ * send every move of a boosted schedule through move().
+ *
+ * The power levels last sent are cached, so only changes go to the unit.
+ */
+class PowerManager {
+private:
+    struct AxisState {
+        double load;            //!< at time
+        base::Time time;
+        PowerLevel level;       //!< heating since time
+        base::Time moveEnd;     //!< level drops to idleHold here, null if not moving
+        int holdSent;           //!< last hold level sent, -1 if unknown
+        int moveSent;           //!< last move level sent, -1 if unknown
+    };
+
+    PowerOptions mOptions;
+    AxisState mAxes[2];
+    mutable boost::mutex mMutex;
+
+    /** Brings the load estimate of \p state forward to \p now. */
+    void advance(AxisState& state, const base::Time& now) const;
+
+    /** Load after running at \p level for \p seconds, starting at \p load. */
+    double heat(double load, PowerLevel level, double seconds) const;
+
+    /** The move power for a move of \p seconds with \p motion on \p state. */
+    PowerLevel select(const AxisState& state, const AxisMotion& motion, double seconds) const;
+
+public:
+    explicit PowerManager(const PowerOptions& options = PowerOptions());
+
+    void setOptions(const PowerOptions& options);
+    const PowerOptions& getOptions() const { return mOptions; }
+
+    /** Sets the idle hold power and regular move power on both axes. */
+    void apply(Driver& driver);
+
+    /**
+     * Moves to \p target, setting the move power of each axis from its
+     * current profile and the thermal budget first. The move enters the
+     * thermal estimate once Driver::setPos returned, not if it threw.
+     * @return the result of Driver::setPos
+     */
+    bool move(Driver& driver, const PanTiltTicks& target, bool awaitCompletion = false);
+
+    /** Estimated thermal load of \p axis now. */
+    double getLoad(const Axis& axis) const;
+
+    /** Forgets the power levels sent, e.g. after the unit was reset. */
+    void invalidate();
+};
+
+} /* namespace ptu */
+
+#endif /* POWER_MANAGER_H_ */
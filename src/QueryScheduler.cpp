@@ -0,0 +1,197 @@
+/**
+  * Motion-aware periodic querying of the Pan-Tilt Unit in idle bus time.
+  * @file QueryScheduler.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "QueryScheduler.h"
+using namespace ptu;
+
+using namespace std;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+bool QueryScheduler::isMoving(const base::Time& now) {
+    if (mMoving && now - mMovingSince > mSettleTimeout) {
+        mMoving = false;
+    }
+    return mMoving;
+}
+
+base::Time QueryScheduler::periodOf(const Query& query) const {
+    return mMoving ? query.movingPeriod : query.settledPeriod;
+}
+
+void QueryScheduler::finishDelivery() {
+    boost::mutex::scoped_lock lock(mMutex);
+    mDelivering = -1;
+    mDelivered.notify_all();
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+QueryScheduler::QueryScheduler(const base::Time& settleTimeout) :
+        mNextId(0),
+        mDelivering(-1),
+        mMoving(false),
+        mSettleTimeout(settleTimeout)
+{}
+
+int QueryScheduler::add(const string& command, const base::Time& movingPeriod,
+                        const base::Time& settledPeriod, bool tracksMotion,
+                        QueryListener* listener)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+
+    Query query;
+    query.id = mNextId++;
+    query.command = command;
+    query.movingPeriod = movingPeriod;
+    query.settledPeriod = settledPeriod;
+    query.tracksMotion = tracksMotion;
+    query.listener = listener;
+    query.unchanged = false;
+
+    mQueries.push_back(query);
+    return query.id;
+}
+
+void QueryScheduler::remove(int id) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    for (vector<Query>::iterator it = mQueries.begin(); it != mQueries.end(); ++it) {
+        if (it->id == id) {
+            mQueries.erase(it);
+            break;
+        }
+    }
+
+    // a listener removing its own query must not wait for itself
+    while (mDelivering == id && mDeliveringThread != boost::this_thread::get_id()) {
+        mDelivered.wait(lock);
+    }
+}
+
+bool QueryScheduler::getLatest(int id, string& reply, base::Time& time) const {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    for (size_t i = 0; i < mQueries.size(); ++i) {
+        if (mQueries[i].id == id && !mQueries[i].lastReplyTime.isNull()) {
+            reply = mQueries[i].lastReply;
+            time = mQueries[i].lastReplyTime;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool QueryScheduler::isMoving() {
+    boost::mutex::scoped_lock lock(mMutex);
+    return isMoving(base::Time::now());
+}
+
+void QueryScheduler::notifyMotion(const base::Time& now) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    mMoving = true;
+    mMovingSince = now;
+
+    // a reply from before the command must not count as the first of two
+    for (size_t i = 0; i < mQueries.size(); ++i) {
+        mQueries[i].unchanged = false;
+        mQueries[i].compared.clear();
+    }
+}
+
+int QueryScheduler::next(const base::Time& now, string& command, base::Time& wait) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    isMoving(now);
+
+    Query* best = 0;
+    base::Time bestDue;
+
+    for (size_t i = 0; i < mQueries.size(); ++i) {
+        Query& query = mQueries[i];
+        base::Time due = query.lastSent.isNull() ? now : query.lastSent + periodOf(query);
+
+        if (best == 0 || due < bestDue) {
+            best = &query;
+            bestDue = due;
+        }
+    }
+
+    if (best == 0) {
+        wait = mSettleTimeout;
+        return -1;
+    }
+
+    if (bestDue > now) {
+        wait = bestDue - now;
+        return -1;
+    }
+
+    best->lastSent = now;
+    command = best->command;
+    return best->id;
+}
+
+void QueryScheduler::deliver(int id, const string& reply, const base::Time& now) {
+    QueryListener* listener = 0;
+
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+
+        size_t trackers = 0;
+        bool settled = true;
+        bool changed = false;
+
+        for (size_t i = 0; i < mQueries.size(); ++i) {
+            Query& query = mQueries[i];
+
+            if (query.id == id && query.listener != 0) {
+                listener = query.listener;
+                mDelivering = id;
+                mDeliveringThread = boost::this_thread::get_id();
+            }
+
+            if (query.id == id && !reply.empty()) {
+                query.unchanged = reply == query.compared;
+                changed = query.tracksMotion && !query.unchanged && !query.lastReplyTime.isNull();
+                query.compared = reply;
+                query.lastReply = reply;
+                query.lastReplyTime = now;
+            }
+
+            if (query.tracksMotion) {
+                ++trackers;
+                settled = settled && query.unchanged;
+            }
+        }
+
+        // trackers report motion the driver did not command, e.g. velocity mode
+        if (changed) {
+            mMoving = true;
+            mMovingSince = now;
+        } else if (trackers > 0 && settled && mMoving) {
+            mMoving = false;
+        }
+    }
+
+    if (listener == 0) {
+        return;
+    }
+
+    // remove() waits for this call, so do not leave it marked on an exception
+    try {
+        listener->onReply(id, reply, now);
+    } catch (...) {
+        finishDelivery();
+        throw;
+    }
+    finishDelivery();
+}
@@ -0,0 +1,141 @@
+/**
+  * Motion-aware periodic querying of the Pan-Tilt Unit in idle bus time.
+  * @file QueryScheduler.h
+  */
+
+#ifndef QUERY_SCHEDULER_H_
+#define QUERY_SCHEDULER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <base/Time.hpp>
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Receives the replies of periodic queries. Called from the I/O thread, so
+ * it must return quickly. Exceptions it throws are logged and dropped.
+ */
+class QueryListener {
+public:
+    virtual ~QueryListener() {}
+
+    /**
+     * @param id the id returned by QueryScheduler::add
+     * @param reply the reply of the unit, empty if the query failed
+     * @param time when the reply was received
+     */
+    virtual void onReply(int id, const std::string& reply, const base::Time& time) = 0;
+};
+
+/**
+ * Runs registered queries periodically, using only the bus time left over
+ * by the CommandScheduler lanes.
+ *
+ * Every query has one period while the unit moves and one once it settled.
+ * The unit counts as moving from the moment a motion command is sent until
+ * the queries flagged as motion trackers (typically the positions) return
+ * the same reply twice in a row after it, or at the latest after the settle
+ * timeout.
+ * The most overdue query is sent first. Queries only ever go out when no
+ * other command waits, so a motion command is delayed by at most the one
+ * short exchange in flight.
+ */
+class QueryScheduler {
+private:
+    struct Query {
+        int id;
+        std::string command;
+        base::Time movingPeriod;
+        base::Time settledPeriod;
+        bool tracksMotion;
+        QueryListener* listener;
+
+        base::Time lastSent;
+        base::Time lastReplyTime;
+        std::string lastReply;
+        std::string compared;   //!< last reply since the last motion command
+        bool unchanged;     //!< last reply equals compared
+    };
+
+    mutable boost::mutex mMutex;
+    std::vector<Query> mQueries;
+    int mNextId;
+
+    int mDelivering;                        //!< query whose listener runs, -1 if none
+    boost::thread::id mDeliveringThread;    //!< the thread running it
+    boost::condition_variable mDelivered;
+
+    bool mMoving;
+    base::Time mMovingSince;
+    base::Time mSettleTimeout;
+
+    bool isMoving(const base::Time& now);
+    base::Time periodOf(const Query& query) const;
+
+    /** Ends the listener call marked by deliver() and wakes remove(). */
+    void finishDelivery();
+
+public:
+    /** @param settleTimeout longest time the unit counts as moving after a motion command */
+    explicit QueryScheduler(const base::Time& settleTimeout = base::Time::fromSeconds(5));
+
+    /**
+     * Registers a periodic query.
+     * @param command the query, e.g. Cmd::getPos(PAN)
+     * @param movingPeriod period while the unit moves
+     * @param settledPeriod period once the unit settled
+     * @param tracksMotion if true, the reply changes while the unit moves
+     * @param listener receives the replies, may be 0
+     * @return an id for remove() and getLatest()
+     */
+    int add(const std::string& command, const base::Time& movingPeriod,
+            const base::Time& settledPeriod, bool tracksMotion = false,
+            QueryListener* listener = 0);
+
+    /**
+     * Unregisters the query \p id. If its listener is being called, waits
+     * until it returned, so that the listener may be destroyed afterwards.
+     * Must not be called with a lock the listener takes.
+     */
+    void remove(int id);
+
+    /**
+     * The latest reply to the query \p id.
+     * @return false if no reply was received yet
+     */
+    bool getLatest(int id, std::string& reply, base::Time& time) const;
+
+    /** True if the unit currently counts as moving. */
+    bool isMoving();
+
+    // called by the CommandScheduler I/O thread
+
+    /** A motion command was sent. */
+    void notifyMotion(const base::Time& now);
+
+    /**
+     * The next query due at \p now.
+     * @param command set to the query to send
+     * @param wait set to the time until the next query is due if none is due yet
+     * @return the id of the query, or -1 if none is due
+     */
+    int next(const base::Time& now, std::string& command, base::Time& wait);
+
+    /** Delivers the \p reply to the query \p id. Empty on failure. */
+    void deliver(int id, const std::string& reply, const base::Time& now);
+};
+
+} /* namespace ptu */
+
+#endif /* QUERY_SCHEDULER_H_ */
@@ -0,0 +1,40 @@
+/**
+  * File descriptor stream that records all traffic into a traffic log.
+  * @file RecordingStream.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "RecordingStream.h"
+using namespace ptu;
+
+#include <base-logging/Logging.hpp>
+
+//==============================================================================
+// Implementation
+//==============================================================================
+RecordingStream::RecordingStream(int fd, boost::shared_ptr<TrafficLogWriter> log) :
+        iodrivers_base::FDStream(fd, true),
+        mLog(log)
+{}
+
+void RecordingStream::record(Direction direction, const uint8_t* buffer, size_t size) {
+    // a failed write closes the log, so this is reported once; appends after
+    // stopRecording closed it are ignored
+    if (!mLog->append(direction, buffer, size)) {
+        LOG_ERROR_S << "RecordingStream: cannot write the traffic log, recording stopped";
+    }
+}
+
+size_t RecordingStream::read(uint8_t* buffer, size_t buffer_size) {
+    size_t size = iodrivers_base::FDStream::read(buffer, buffer_size);
+    record(INBOUND, buffer, size);
+    return size;
+}
+
+size_t RecordingStream::write(uint8_t const* buffer, size_t buffer_size) {
+    size_t size = iodrivers_base::FDStream::write(buffer, buffer_size);
+    record(OUTBOUND, buffer, size);
+    return size;
+}
@@ -0,0 +1,48 @@
+/**
+  * File descriptor stream that records all traffic into a traffic log.
+  * @file RecordingStream.h
+  */
+
+#ifndef RECORDING_STREAM_H_
+#define RECORDING_STREAM_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <boost/shared_ptr.hpp>
+#include <iodrivers_base/IOStream.hpp>
+
+#include "TrafficLog.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Behaves exactly like an iodrivers_base::FDStream, but logs every chunk
+ * written to and read from the file descriptor. The chunks are logged as
+ * they cross the descriptor, i.e. before any packet extraction, so noise and
+ * fragmentation are preserved for replay.
+ */
+class RecordingStream : public iodrivers_base::FDStream {
+private:
+    boost::shared_ptr<TrafficLogWriter> mLog;
+
+    /** Appends a chunk to the log, reporting a failed write. */
+    void record(Direction direction, const uint8_t* buffer, size_t size);
+
+public:
+    /**
+     * @param fd the descriptor to operate on, closed on destruction
+     * @param log where the traffic is recorded
+     */
+    RecordingStream(int fd, boost::shared_ptr<TrafficLogWriter> log);
+
+    virtual size_t read(uint8_t* buffer, size_t buffer_size);
+    virtual size_t write(uint8_t const* buffer, size_t buffer_size);
+};
+
+} /* namespace ptu */
+
+#endif /* RECORDING_STREAM_H_ */
@@ -0,0 +1,132 @@
+/**
+  * Stream that feeds the driver from a recorded traffic log.
+  * @file ReplayStream.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "ReplayStream.h"
+using namespace ptu;
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include <iodrivers_base/Exceptions.hpp>
+using namespace std;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+void ReplayStream::advance() {
+    mRecord = mLog.next(mPayload);
+    mConsumed = 0;
+}
+
+int64_t ReplayStream::inboundDelayNs() const {
+    if (mRecord == 0 || mRecord->direction != INBOUND) {
+        return -1;
+    }
+
+    if (mMode == REPLAY_FAST) {
+        return 0;
+    }
+
+    int64_t due = mAnchorNs + int64_t(mRecord->timeNs);
+    return std::max<int64_t>(0, due - int64_t(TrafficLog::monotonicNs()));
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+ReplayStream::ReplayStream(const string& path, ReplayMode mode) :
+        mLog(path),
+        mMode(mode),
+        mRecord(0),
+        mPayload(0),
+        mConsumed(0),
+        mAnchorNs(int64_t(TrafficLog::monotonicNs()))
+{
+    advance();
+}
+
+void ReplayStream::waitRead(base::Time const& timeout) {
+    int64_t delay = inboundDelayNs();
+
+    if (delay < 0) {
+        usleep(timeout.toMicroseconds());
+        throw iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::FIRST_BYTE,
+                mRecord == 0 ? "ReplayStream: end of log reached"
+                             : "ReplayStream: the log expects outbound data first");
+    }
+
+    if (delay > timeout.toMicroseconds() * 1000) {
+        usleep(timeout.toMicroseconds());
+        throw iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::FIRST_BYTE,
+                "ReplayStream: no recorded data within the timeout");
+    }
+
+    if (delay > 0) {
+        usleep(delay / 1000);
+    }
+}
+
+void ReplayStream::waitWrite(base::Time const& timeout) {
+}
+
+size_t ReplayStream::read(uint8_t* buffer, size_t buffer_size) {
+    if (inboundDelayNs() != 0) {
+        return 0;
+    }
+
+    size_t size = std::min<size_t>(buffer_size, mRecord->size - mConsumed);
+    memcpy(buffer, mPayload + mConsumed, size);
+    mConsumed += size;
+
+    if (mConsumed == mRecord->size) {
+        advance();
+    }
+
+    return size;
+}
+
+size_t ReplayStream::write(uint8_t const* buffer, size_t buffer_size) {
+    size_t written = 0;
+
+    while (written < buffer_size) {
+        // skip whatever inbound data the driver never read
+        while (mRecord != 0 && mRecord->direction == INBOUND) {
+            advance();
+        }
+
+        if (mRecord == 0) {
+            throw std::runtime_error("ReplayStream: write past the end of the log");
+        }
+
+        size_t size = std::min<size_t>(buffer_size - written, mRecord->size - mConsumed);
+        if (memcmp(buffer + written, mPayload + mConsumed, size) != 0) {
+            throw std::runtime_error("ReplayStream: written data differs from the log, expected '" +
+                    string(reinterpret_cast<const char*>(mPayload + mConsumed), size) + "' got '" +
+                    string(reinterpret_cast<const char*>(buffer + written), size) + "'");
+        }
+
+        written += size;
+        mConsumed += size;
+
+        if (mConsumed == mRecord->size) {
+            mAnchorNs = int64_t(TrafficLog::monotonicNs()) - int64_t(mRecord->timeNs);
+            advance();
+        }
+    }
+
+    return written;
+}
+
+void ReplayStream::clear() {
+    while (inboundDelayNs() == 0) {
+        advance();
+    }
+}
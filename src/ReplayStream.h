@@ -0,0 +1,82 @@
+/**
+  * Stream that feeds the driver from a recorded traffic log.
+  * @file ReplayStream.h
+  */
+
+#ifndef REPLAY_STREAM_H_
+#define REPLAY_STREAM_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <iodrivers_base/IOStream.hpp>
+
+#include "TrafficLog.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * How fast a log is replayed.
+ */
+enum ReplayMode {
+    REPLAY_REALTIME,    //!< inbound chunks arrive with their recorded delays
+    REPLAY_FAST         //!< inbound chunks are available as soon as possible
+};
+
+/**
+ * Replays a traffic log recorded by RecordingStream.
+ *
+ * Replay is causal: an inbound chunk is only delivered once every outbound
+ * chunk recorded before it has been written again, and the written bytes must
+ * match the recorded ones. In REPLAY_REALTIME mode the delay between the last
+ * outbound chunk and an inbound chunk is reproduced as recorded.
+ */
+class ReplayStream : public iodrivers_base::IOStream {
+private:
+    TrafficLogReader mLog;
+    ReplayMode mMode;
+
+    const TrafficLogRecord* mRecord;    //!< The current record, 0 at end of log.
+    const uint8_t* mPayload;            //!< Payload of the current record.
+    size_t mConsumed;                   //!< Bytes of the current record already used.
+
+    int64_t mAnchorNs;  //!< Replay time minus recorded time of the last outbound chunk.
+
+    void advance();
+
+    /** Nanoseconds until the current inbound chunk is due, or -1 if it is not inbound. */
+    int64_t inboundDelayNs() const;
+
+public:
+    /**
+     * @param path the traffic log to replay
+     * @param mode the replay timing
+     * @throws std::runtime_error if the log cannot be opened
+     */
+    ReplayStream(const std::string& path, ReplayMode mode = REPLAY_REALTIME);
+
+    /**
+     * @throws iodrivers_base::TimeoutError if no inbound chunk becomes
+     *         available within \p timeout
+     */
+    virtual void waitRead(base::Time const& timeout);
+    virtual void waitWrite(base::Time const& timeout);
+    virtual size_t read(uint8_t* buffer, size_t buffer_size);
+
+    /**
+     * Checks \p buffer against the recorded outbound traffic.
+     * @throws std::runtime_error if the bytes differ from the recording
+     */
+    virtual size_t write(uint8_t const* buffer, size_t buffer_size);
+    virtual void clear();
+
+    /** True once every record of the log has been consumed. */
+    bool atEnd() const { return mRecord == 0; }
+};
+
+} /* namespace ptu */
+
+#endif /* REPLAY_STREAM_H_ */
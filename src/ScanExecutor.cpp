@@ -0,0 +1,115 @@
+/**
+  * Execution of multi-viewpoint scans with overlapped capture processing.
+  * @file ScanExecutor.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "ScanExecutor.h"
+#include "ScanPlanner.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+void ScanExecutor::workerLoop() {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+
+    while (true) {
+        while (mJobs.empty() && !mStop) {
+            mCond.wait(lock);
+        }
+
+        if (mJobs.empty()) {
+            return;
+        }
+
+        Job job = mJobs.front();
+        mJobs.pop_front();
+
+        lock.unlock();
+        string error;
+        try {
+            mListener.process(job.first, job.second);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        lock.lock();
+
+        if (!error.empty() && mError.empty()) {
+            mError = error;
+        }
+
+        --mBusy;
+        mCond.notify_all();
+    }
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+ScanExecutor::ScanExecutor(Driver& driver, ScanListener& listener) :
+        mDriver(driver),
+        mListener(listener),
+        mBusy(0),
+        mStop(false),
+        mWorker(&ScanExecutor::workerLoop, this)
+{}
+
+ScanExecutor::~ScanExecutor() {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCond.notify_all();
+    mWorker.join();
+}
+
+vector<size_t> ScanExecutor::run(const vector<PanTiltTicks>& viewpoints) {
+    PanTiltTicks start(mDriver.getPos(PAN, false), mDriver.getPos(TILT, false));
+
+    double duration;
+    vector<size_t> order = ScanPlanner(mDriver.getPredictor()).plan(start, viewpoints, &duration);
+    LOG_INFO_S << "Scan of " << viewpoints.size() << " viewpoints planned, predicted move time "
+               << duration << " s";
+
+    execute(viewpoints, order);
+    return order;
+}
+
+void ScanExecutor::execute(const vector<PanTiltTicks>& viewpoints, const vector<size_t>& order) {
+    for (size_t i = 0; i < order.size(); ++i) {
+        const PanTiltTicks& target = viewpoints.at(order[i]);
+
+        mDriver.setPos(target, true);
+        mListener.capture(order[i], target);
+
+        {
+            boost::lock_guard<boost::mutex> lock(mMutex);
+            mJobs.push_back(Job(order[i], target));
+            ++mBusy;
+        }
+        mCond.notify_all();
+    }
+
+    waitProcessing();
+}
+
+void ScanExecutor::waitProcessing() {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+
+    while (mBusy > 0) {
+        mCond.wait(lock);
+    }
+
+    if (!mError.empty()) {
+        string error = mError;
+        mError.clear();
+        throw std::runtime_error("ScanExecutor: processing failed: " + error);
+    }
+}
@@ -0,0 +1,105 @@
+/**
+  * Execution of multi-viewpoint scans with overlapped capture processing.
+  * @file ScanExecutor.h
+  */
+
+#ifndef SCAN_EXECUTOR_H_
+#define SCAN_EXECUTOR_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "Units.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+class Driver;
+
+/**
+ * Receives the viewpoints reached by a ScanExecutor.
+ */
+class ScanListener {
+public:
+    virtual ~ScanListener() {}
+
+    /**
+     * Called once the unit arrived at a viewpoint. Should trigger the camera
+     * and return as soon as the exposure is over, since the unit moves on
+     * to the next viewpoint right after.
+     * @param index index of the viewpoint in the list given to the executor
+     * @param position the viewpoint
+     */
+    virtual void capture(size_t index, const PanTiltTicks& position) = 0;
+
+    /**
+     * Called from the executor's worker thread after capture() returned,
+     * while the unit already moves to the next viewpoint. Put readout and
+     * processing of the frame here.
+     */
+    virtual void process(size_t index, const PanTiltTicks& position) {}
+};
+
+/**
+ * Runs a scan job: plans the viewpoint order with a ScanPlanner and visits
+ * the viewpoints with coordinated pan/tilt moves. Processing of a capture
+ * overlaps with the move to the next viewpoint and its exposure.
+ */
+class ScanExecutor {
+private:
+    typedef std::pair<size_t, PanTiltTicks> Job;
+
+    Driver& mDriver;
+    ScanListener& mListener;
+
+    boost::mutex mMutex;
+    boost::condition_variable mCond;
+    std::deque<Job> mJobs;
+    size_t mBusy;               //!< Jobs queued or being processed.
+    std::string mError;         //!< First error thrown by ScanListener::process.
+    bool mStop;
+    boost::thread mWorker;
+
+    void workerLoop();
+
+    // non-copyable
+    ScanExecutor(const ScanExecutor&);
+    ScanExecutor& operator=(const ScanExecutor&);
+
+public:
+    ScanExecutor(Driver& driver, ScanListener& listener);
+    ~ScanExecutor();
+
+    /**
+     * Plans the visiting order from the current position with the driver's
+     * motion model and executes it.
+     * @return the visiting order that was executed
+     */
+    std::vector<size_t> run(const std::vector<PanTiltTicks>& viewpoints);
+
+    /**
+     * Visits \p viewpoints in the given \p order and waits for all captures
+     * to be processed.
+     * @throws std::runtime_error if ScanListener::process failed
+     */
+    void execute(const std::vector<PanTiltTicks>& viewpoints, const std::vector<size_t>& order);
+
+    /**
+     * Blocks until all pending captures are processed.
+     * @throws std::runtime_error if ScanListener::process failed
+     */
+    void waitProcessing();
+};
+
+} /* namespace ptu */
+
+#endif /* SCAN_EXECUTOR_H_ */
@@ -0,0 +1,127 @@
+/**
+  * Ordering of pan/tilt viewpoints for minimum total move time.
+  * @file ScanPlanner.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "ScanPlanner.h"
+using namespace ptu;
+
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+//==============================================================================
+// Private static methods implementation
+//==============================================================================
+double ScanPlanner::pathCost(const vector<double>& cost, size_t n, const vector<size_t>& path) {
+    double total = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        total += cost[path[i - 1] * (n + 1) + path[i]];
+    }
+    return total;
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+ScanPlanner::ScanPlanner(const MotionModel& model, size_t maxPasses) :
+        mPredictor(model),
+        mMaxPasses(maxPasses)
+{}
+
+ScanPlanner::ScanPlanner(const MovePredictor& predictor, size_t maxPasses) :
+        mPredictor(predictor),
+        mMaxPasses(maxPasses)
+{}
+
+vector<size_t> ScanPlanner::plan(const PanTiltTicks& start,
+        const vector<PanTiltTicks>& viewpoints, double* duration) const
+{
+    const size_t n = viewpoints.size();
+
+    // node 0 is the start position, node i the viewpoint i - 1
+    vector<PanTiltTicks> nodes(1, start);
+    nodes.insert(nodes.end(), viewpoints.begin(), viewpoints.end());
+
+    vector<double> cost((n + 1) * (n + 1));
+    for (size_t i = 0; i <= n; ++i) {
+        for (size_t j = i; j <= n; ++j) {
+            cost[i * (n + 1) + j] = cost[j * (n + 1) + i] = mPredictor.duration(nodes[i], nodes[j]);
+        }
+    }
+
+    // greedy construction
+    vector<size_t> path(1, 0);
+    vector<bool> visited(n + 1, false);
+    visited[0] = true;
+
+    for (size_t k = 0; k < n; ++k) {
+        size_t from = path.back();
+        size_t best = 0;
+        double bestCost = numeric_limits<double>::max();
+
+        for (size_t j = 1; j <= n; ++j) {
+            if (!visited[j] && cost[from * (n + 1) + j] < bestCost) {
+                best = j;
+                bestCost = cost[from * (n + 1) + j];
+            }
+        }
+
+        visited[best] = true;
+        path.push_back(best);
+    }
+
+    // 2-opt on the open path, the start node stays in place
+    for (size_t pass = 0; pass < mMaxPasses; ++pass) {
+        bool improved = false;
+
+        for (size_t i = 1; i < n; ++i) {
+            for (size_t j = i + 1; j <= n; ++j) {
+                double before = cost[path[i - 1] * (n + 1) + path[i]];
+                double after = cost[path[i - 1] * (n + 1) + path[j]];
+
+                if (j < n) {
+                    before += cost[path[j] * (n + 1) + path[j + 1]];
+                    after += cost[path[i] * (n + 1) + path[j + 1]];
+                }
+
+                if (after + 1e-9 < before) {
+                    reverse(path.begin() + i, path.begin() + j + 1);
+                    improved = true;
+                }
+            }
+        }
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    if (duration != 0) {
+        *duration = pathCost(cost, n, path);
+    }
+
+    vector<size_t> order;
+    order.reserve(n);
+    for (size_t i = 1; i <= n; ++i) {
+        order.push_back(path[i] - 1);
+    }
+    return order;
+}
+
+double ScanPlanner::duration(const PanTiltTicks& start, const vector<PanTiltTicks>& viewpoints,
+        const vector<size_t>& order) const
+{
+    double total = 0;
+    PanTiltTicks current = start;
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        total += mPredictor.duration(current, viewpoints.at(order[i]));
+        current = viewpoints[order[i]];
+    }
+
+    return total;
+}
@@ -0,0 +1,74 @@
+/**
+  * Ordering of pan/tilt viewpoints for minimum total move time.
+  * @file ScanPlanner.h
+  */
+
+#ifndef SCAN_PLANNER_H_
+#define SCAN_PLANNER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <vector>
+
+#include "MovePredictor.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Orders a set of viewpoints so that visiting all of them from a start
+ * position takes as little move time as possible.
+ *
+ * The cost of going from one viewpoint to another is the duration of the
+ * coordinated move predicted by the MovePredictor. The tour is built greedily
+ * (nearest viewpoint first) and then improved by 2-opt segment reversals
+ * until no reversal shortens it any more.
+ */
+class ScanPlanner {
+private:
+    MovePredictor mPredictor;
+    size_t mMaxPasses;
+
+    /** Cost of the open path \p path through the (n+1)x(n+1) matrix \p cost. */
+    static double pathCost(const std::vector<double>& cost, size_t n, const std::vector<size_t>& path);
+
+public:
+    /**
+     * @param model the motion model, e.g. Driver::getMotionModel()
+     * @param maxPasses upper bound on the 2-opt improvement passes
+     */
+    explicit ScanPlanner(const MotionModel& model, size_t maxPasses = 50);
+
+    /**
+     * @param predictor the calibrated move predictor, e.g. Driver::getPredictor()
+     * @param maxPasses upper bound on the 2-opt improvement passes
+     */
+    explicit ScanPlanner(const MovePredictor& predictor, size_t maxPasses = 50);
+
+    void setMotionModel(const MotionModel& model) { mPredictor.setMotionModel(model); }
+    MotionModel getMotionModel() const { return mPredictor.getMotionModel(); }
+
+    void setPredictor(const MovePredictor& predictor) { mPredictor = predictor; }
+    const MovePredictor& getPredictor() const { return mPredictor; }
+
+    /**
+     * Plans the visiting order.
+     * @param start the current position of the unit
+     * @param viewpoints the positions to visit
+     * @param duration if non-null, set to the predicted total move time in seconds
+     * @return the indices of \p viewpoints in visiting order
+     */
+    std::vector<size_t> plan(const PanTiltTicks& start,
+            const std::vector<PanTiltTicks>& viewpoints, double* duration = 0) const;
+
+    /** Predicted total move time in seconds of visiting \p viewpoints in \p order. */
+    double duration(const PanTiltTicks& start, const std::vector<PanTiltTicks>& viewpoints,
+            const std::vector<size_t>& order) const;
+};
+
+} /* namespace ptu */
+
+#endif /* SCAN_PLANNER_H_ */
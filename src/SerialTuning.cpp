@@ -0,0 +1,157 @@
+/**
+  * Latency tuning of the serial port the Pan-Tilt Unit is connected to.
+  * @file SerialTuning.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "SerialTuning.h"
+using namespace ptu;
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+//==============================================================================
+// Helpers
+//==============================================================================
+namespace {
+
+const tcflag_t RAW_IFLAG_OFF = IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY;
+const tcflag_t RAW_LFLAG_OFF = ECHO | ECHONL | ICANON | ISIG | IEXTEN;
+
+bool isRaw(const termios& tio) {
+    return (tio.c_iflag & RAW_IFLAG_OFF) == 0 && (tio.c_oflag & OPOST) == 0 &&
+           (tio.c_lflag & RAW_LFLAG_OFF) == 0 && (tio.c_cflag & (CSIZE | PARENB)) == CS8;
+}
+
+bool hasReadThresholds(const termios& tio) {
+    return tio.c_cc[VMIN] == 0 && tio.c_cc[VTIME] == 0;
+}
+
+/** Sets the ASYNC_LOW_LATENCY flag, true if it is set afterwards. */
+bool setLowLatency(int fd) {
+#if defined(TIOCGSERIAL) && defined(TIOCSSERIAL) && defined(ASYNC_LOW_LATENCY)
+    serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+        return false;
+    }
+    if ((serial.flags & ASYNC_LOW_LATENCY) == 0) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &serial) != 0 || ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+            return false;
+        }
+    }
+    return (serial.flags & ASYNC_LOW_LATENCY) != 0;
+#else
+    return false;
+#endif
+}
+
+/** The sysfs attribute holding the latency timer of the adapter of \p port, empty if none. */
+string latencyTimerPath(const string& port) {
+    char resolved[PATH_MAX];
+    if (port.empty() || realpath(port.c_str(), resolved) == 0) {
+        return string();
+    }
+
+    const char* name = strrchr(resolved, '/');
+    return string("/sys/bus/usb-serial/devices/") + (name ? name + 1 : resolved) + "/latency_timer";
+}
+
+/**
+ * Lowers the latency timer of the USB-serial adapter of \p port to 1ms.
+ * @param previous set to the value replaced, -1 if none was
+ */
+bool setLatencyTimer(const string& port, int& previous) {
+    previous = -1;
+
+    string path = latencyTimerPath(port);
+    FILE* file = path.empty() ? 0 : fopen(path.c_str(), "r+");
+    if (file == 0) {
+        return false;
+    }
+
+    int timer = -1;
+    if (fscanf(file, "%d", &timer) == 1 && timer > 1) {
+        rewind(file);
+        fputs("1\n", file);
+        fflush(file);
+        rewind(file);
+        previous = timer;
+        timer = -1;
+        if (fscanf(file, "%d", &timer) != 1) {
+            timer = -1;
+        }
+    }
+    fclose(file);
+    return timer == 1;
+}
+
+} /* namespace */
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+int SerialTuning::apply(int fd, const string& port, int* previousTimer) {
+    int applied = 0;
+
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        tio.c_iflag &= ~RAW_IFLAG_OFF;
+        tio.c_oflag &= ~OPOST;
+        tio.c_lflag &= ~RAW_LFLAG_OFF;
+        tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS);
+        tio.c_cflag |= CS8 | CREAD | CLOCAL;
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+
+        // tcsetattr succeeds if any of the changes was made, so read back
+        if (tcsetattr(fd, TCSANOW, &tio) == 0 && tcgetattr(fd, &tio) == 0) {
+            applied |= isRaw(tio) ? RAW : 0;
+            applied |= hasReadThresholds(tio) ? READ_THRESHOLDS : 0;
+        }
+    }
+
+    applied |= setLowLatency(fd) ? LOW_LATENCY : 0;
+    int previous;
+    applied |= setLatencyTimer(port, previous) ? LATENCY_TIMER : 0;
+    if (previousTimer != 0) {
+        *previousTimer = previous;
+    }
+    return applied;
+}
+
+bool SerialTuning::restoreLatencyTimer(const string& port, int timer) {
+    string path = latencyTimerPath(port);
+    FILE* file = timer > 0 && !path.empty() ? fopen(path.c_str(), "w") : 0;
+    if (file == 0) {
+        return false;
+    }
+
+    bool written = fprintf(file, "%d\n", timer) > 0;
+    return fclose(file) == 0 && written;
+}
+
+string SerialTuning::describe(int flags) {
+    static const char* names[] = { "raw", "read thresholds", "low latency", "latency timer" };
+
+    string description;
+    for (int i = 0; i < 4; ++i) {
+        if (flags & (1 << i)) {
+            description += (description.empty() ? "" : ", ") + string(names[i]);
+        }
+    }
+    return description.empty() ? "none" : description;
+}
@@ -0,0 +1,74 @@
+/**
+  * Latency tuning of the serial port the Pan-Tilt Unit is connected to.
+  * @file SerialTuning.h
+  */
+
+#ifndef SERIAL_TUNING_H_
+#define SERIAL_TUNING_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <string>
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Tunes an open serial port for the short request/reply exchanges of the
+ * unit, where every millisecond a reply sits in a buffer adds to the latency
+ * of each command:
+ *
+ * - RAW: no line processing at all (no canonical mode, echo, CR/NL
+ *   translation, signals or software flow control), 8N1 without modem
+ *   control; the '\\r' terminated replies are framed by the driver.
+ * - READ_THRESHOLDS: VMIN = 0 and VTIME = 0, so a read returns whatever
+ *   arrived right away instead of waiting for more bytes or an inter-byte
+ *   timer.
+ * - LOW_LATENCY: the ASYNC_LOW_LATENCY flag of the kernel serial driver
+ *   (TIOCSSERIAL), which makes it push received bytes to the tty layer
+ *   immediately. Only real serial drivers support it, ptys do not.
+ * - LATENCY_TIMER: the latency timer of USB-serial adapters (FTDI and
+ *   compatibles) lowered from 16ms to 1ms through sysfs. Needs write access
+ *   to the attribute, usually root or a udev rule. The timer belongs to the
+ *   adapter and outlives the process, so the caller restores the replaced
+ *   value (restoreLatencyTimer) when it closes the port.
+ *
+ * Each setting is read back after it was applied; only those actually in
+ * effect are reported.
+ */
+class SerialTuning {
+public:
+    enum Flag {
+        RAW             = 1,
+        READ_THRESHOLDS = 2,
+        LOW_LATENCY     = 4,
+        LATENCY_TIMER   = 8,
+        ALL             = RAW | READ_THRESHOLDS | LOW_LATENCY | LATENCY_TIMER
+    };
+
+    /**
+     * Applies all settings to the serial port \p fd, opened from \p port.
+     * The port name locates the latency timer, it is skipped if empty.
+     * @param previousTimer if not 0, set to the latency timer replaced, -1
+     *        if it was not changed
+     * @return the Flags of the settings in effect afterwards
+     */
+    static int apply(int fd, const std::string& port = std::string(), int* previousTimer = 0);
+
+    /**
+     * Sets the latency timer of the adapter of \p port back to \p timer,
+     * as returned by apply().
+     * @return false if there is nothing to restore or it failed
+     */
+    static bool restoreLatencyTimer(const std::string& port, int timer);
+
+    /** A readable list of \p flags, e.g. "raw, read thresholds". */
+    static std::string describe(int flags);
+};
+
+} /* namespace ptu */
+
+#endif /* SERIAL_TUNING_H_ */
@@ -0,0 +1,82 @@
+/**
+  * Layout of the shared memory segment holding the published head state.
+  * @file SharedState.h
+  */
+
+#ifndef SHARED_STATE_H_
+#define SHARED_STATE_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+#include <boost/static_assert.hpp>
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * One published state of the head. Positions are device positions, angles in
+ * radians, speeds per second.
+ */
+struct StateSample {
+    int64_t timeUs;         //!< microseconds since the epoch, as base::Time
+    int32_t pan;
+    int32_t tilt;
+    int32_t panSpeed;
+    int32_t tiltSpeed;
+    double panRad;
+    double tiltRad;
+    double panSpeedRad;
+    double tiltSpeedRad;
+};
+
+/**
+ * A ring slot, guarded by its own sequence counter: 2 * index + 1 while the
+ * sample of that index is written, 2 * index + 2 once it is complete.
+ */
+struct SharedStateSlot {
+    boost::atomic<uint64_t> sequence;
+    StateSample sample;
+};
+
+/**
+ * Start of the segment, followed by capacity slots.
+ */
+struct SharedStateHeader {
+    char magic[8];              //!< "PTUSTATE"
+    uint32_t version;
+    uint32_t capacity;          //!< number of slots
+    boost::atomic<uint64_t> published;  //!< samples published so far
+    char padding[40];           //!< keeps the writer counter off the first slot's cache line
+};
+
+/** Magic and version identifying a valid segment. */
+static const char SHARED_STATE_MAGIC[8] = { 'P', 'T', 'U', 'S', 'T', 'A', 'T', 'E' };
+static const uint32_t SHARED_STATE_VERSION = 1;
+
+/** Size in bytes of a segment of \p capacity slots. */
+inline size_t sharedStateSize(uint32_t capacity) {
+    return sizeof(SharedStateHeader) + size_t(capacity) * sizeof(SharedStateSlot);
+}
+
+/** The slots, right after the header. */
+inline SharedStateSlot* sharedStateSlots(SharedStateHeader* header) {
+    return reinterpret_cast<SharedStateSlot*>(header + 1);
+}
+
+inline const SharedStateSlot* sharedStateSlots(const SharedStateHeader* header) {
+    return reinterpret_cast<const SharedStateSlot*>(header + 1);
+}
+
+// the counters are shared between processes, which needs address-free atomics
+BOOST_STATIC_ASSERT(BOOST_ATOMIC_INT64_LOCK_FREE == 2);
+
+} /* namespace ptu */
+
+#endif /* SHARED_STATE_H_ */
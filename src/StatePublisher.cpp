@@ -0,0 +1,196 @@
+/**
+  * Publication of the head state into POSIX shared memory.
+  * @file StatePublisher.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "StatePublisher.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+using namespace std;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+StateSample StatePublisher::makeSample(const base::Time& time, const PanTiltTicks& pos,
+                                       const PanTiltTicks& speed, const Units& units)
+{
+    StateSample sample;
+    sample.timeUs = time.toMicroseconds();
+    sample.pan = pos.pan;
+    sample.tilt = pos.tilt;
+    sample.panSpeed = speed.pan;
+    sample.tiltSpeed = speed.tilt;
+    sample.panRad = units.axis(PAN).ticksToRad(pos.pan);
+    sample.tiltRad = units.axis(TILT).ticksToRad(pos.tilt);
+    sample.panSpeedRad = units.axis(PAN).ticksToRadPerSec(speed.pan);
+    sample.tiltSpeedRad = units.axis(TILT).ticksToRadPerSec(speed.tilt);
+    return sample;
+}
+
+void StatePublisher::detach() {
+    QueryScheduler* queries;
+    int ids[4];
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        queries = mQueries;
+        std::copy(mQueryIds, mQueryIds + 4, ids);
+        mQueries = 0;
+    }
+    if (queries == 0) {
+        return;
+    }
+
+    // without the lock, remove() waits for a reply being delivered to onReply
+    for (int i = 0; i < 4; ++i) {
+        queries->remove(ids[i]);
+    }
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+StatePublisher::StatePublisher(const string& name, uint32_t capacity) :
+        mName(name),
+        mHeader(0),
+        mSlots(0),
+        mSize(sharedStateSize(capacity)),
+        mQueries(0)
+{
+    if (capacity == 0) {
+        throw std::runtime_error("StatePublisher: capacity must not be 0");
+    }
+
+    // a new segment, so readers of a previous one do not see a mixed layout
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("StatePublisher: cannot create shared memory " + name +
+                                 ": " + strerror(errno));
+    }
+
+    if (ftruncate(fd, mSize) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("StatePublisher: cannot size shared memory " + name);
+    }
+
+    void* memory = mmap(0, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("StatePublisher: cannot map shared memory " + name);
+    }
+
+    // the segment is zero-filled: all counters start at 0
+    mHeader = static_cast<SharedStateHeader*>(memory);
+    mSlots = sharedStateSlots(mHeader);
+    mHeader->version = SHARED_STATE_VERSION;
+    mHeader->capacity = capacity;
+
+    // readers check the magic last, once the rest is set
+    boost::atomic_thread_fence(boost::memory_order_release);
+    memcpy(mHeader->magic, SHARED_STATE_MAGIC, sizeof(mHeader->magic));
+
+    memset(&mPending, 0, sizeof(mPending));
+    for (int i = 0; i < 4; ++i) {
+        mQueryIds[i] = -1;
+    }
+}
+
+StatePublisher::~StatePublisher() {
+    detach();
+    munmap(mHeader, mSize);
+    shm_unlink(mName.c_str());
+}
+
+void StatePublisher::publish(const StateSample& sample) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    uint64_t index = mHeader->published.load(boost::memory_order_relaxed);
+    SharedStateSlot& slot = mSlots[index % mHeader->capacity];
+
+    slot.sequence.store(2 * index + 1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+    slot.sample = sample;
+    slot.sequence.store(2 * index + 2, boost::memory_order_release);
+
+    mHeader->published.store(index + 1, boost::memory_order_release);
+}
+
+void StatePublisher::publish(const base::Time& time, const PanTiltTicks& pos,
+                             const PanTiltTicks& speed, const Units& units)
+{
+    publish(makeSample(time, pos, speed, units));
+}
+
+void StatePublisher::attach(QueryScheduler& queries, const Units& units,
+                            const base::Time& movingPeriod, const base::Time& settledPeriod)
+{
+    detach();
+
+    boost::mutex::scoped_lock lock(mMutex);
+    mUnits = units;
+    mQueries = &queries;
+
+    // the tilt position goes last in each round and triggers the publication
+    mQueryIds[2] = queries.add(Cmd::getCurrentSpeed(PAN), movingPeriod, settledPeriod, false, this);
+    mQueryIds[3] = queries.add(Cmd::getCurrentSpeed(TILT), movingPeriod, settledPeriod, false, this);
+    mQueryIds[0] = queries.add(Cmd::getPos(PAN), movingPeriod, settledPeriod, true, this);
+    mQueryIds[1] = queries.add(Cmd::getPos(TILT), movingPeriod, settledPeriod, true, this);
+}
+
+void StatePublisher::setUnits(const Units& units) {
+    boost::mutex::scoped_lock lock(mMutex);
+    mUnits = units;
+}
+
+void StatePublisher::onReply(int id, const string& reply, const base::Time& time) {
+    if (reply.size() < 3) {
+        return;
+    }
+
+    int value;
+    try {
+        value = Driver::getQuery<int>(reply);
+    } catch (const boost::bad_lexical_cast&) {
+        return;
+    }
+
+    StateSample sample;
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+
+        if (id == mQueryIds[0]) {
+            mPending.pan = value;
+        } else if (id == mQueryIds[2]) {
+            mPending.panSpeed = value;
+        } else if (id == mQueryIds[3]) {
+            mPending.tiltSpeed = value;
+        } else if (id == mQueryIds[1]) {
+            mPending.tilt = value;
+        }
+
+        if (id != mQueryIds[1]) {
+            return;
+        }
+
+        sample = makeSample(time, PanTiltTicks(mPending.pan, mPending.tilt),
+                            PanTiltTicks(mPending.panSpeed, mPending.tiltSpeed), mUnits);
+    }
+
+    publish(sample);
+}
@@ -0,0 +1,103 @@
+/**
+  * Publication of the head state into POSIX shared memory.
+  * @file StatePublisher.h
+  */
+
+#ifndef STATE_PUBLISHER_H_
+#define STATE_PUBLISHER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+#include <base/Time.hpp>
+
+#include "QueryScheduler.h"
+#include "SharedState.h"
+#include "Units.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Writes StateSample records into a ring in a POSIX shared memory segment,
+ * where any number of processes read them with a StateReader without ever
+ * blocking the publisher.
+ *
+ * Each slot carries a sequence counter (a per-slot seqlock), so a reader
+ * detects a sample that is being written or was overwritten while it copied
+ * it and simply retries or skips it. The publisher never waits for readers.
+ *
+ * Samples are either published directly or collected from periodic queries:
+ * attach() registers position and speed queries with a QueryScheduler and
+ * publishes a sample whenever a new tilt position, the last of the four
+ * replies of a round, arrives.
+ */
+class StatePublisher : public QueryListener {
+private:
+    std::string mName;
+    SharedStateHeader* mHeader;
+    SharedStateSlot* mSlots;
+    size_t mSize;
+
+    // collected from the periodic queries
+    boost::mutex mMutex;
+    Units mUnits;
+    QueryScheduler* mQueries;
+    int mQueryIds[4];   //!< pan/tilt position, pan/tilt speed
+    StateSample mPending;
+
+    /** Unregisters the queries; takes mMutex itself, so call it without. */
+    void detach();
+
+    static StateSample makeSample(const base::Time& time, const PanTiltTicks& pos,
+                                  const PanTiltTicks& speed, const Units& units);
+
+    // non-copyable
+    StatePublisher(const StatePublisher&);
+    StatePublisher& operator=(const StatePublisher&);
+
+public:
+    /**
+     * Creates (or replaces) the segment \p name, e.g. "/ptu_state".
+     * @param capacity number of samples kept for the readers
+     * @throws std::runtime_error if the segment cannot be created
+     */
+    explicit StatePublisher(const std::string& name, uint32_t capacity = 256);
+
+    /** Detaches and removes the segment. Mapped readers keep the last samples. */
+    ~StatePublisher();
+
+    /** Publishes \p sample as the newest one. */
+    void publish(const StateSample& sample);
+
+    /** Publishes positions and speeds, converted to angles with \p units. */
+    void publish(const base::Time& time, const PanTiltTicks& pos, const PanTiltTicks& speed,
+                 const Units& units);
+
+    /**
+     * Registers position and current speed queries with \p queries and
+     * publishes their results, converted with \p units.
+     */
+    void attach(QueryScheduler& queries, const Units& units,
+                const base::Time& movingPeriod = base::Time::fromMilliseconds(50),
+                const base::Time& settledPeriod = base::Time::fromSeconds(1));
+
+    /** Replaces the units the query results are converted with, e.g. after Driver::setStepMode. */
+    void setUnits(const Units& units);
+
+    /** Number of samples published so far. */
+    uint64_t getPublished() const { return mHeader->published.load(boost::memory_order_relaxed); }
+
+    const std::string& getName() const { return mName; }
+
+    void onReply(int id, const std::string& reply, const base::Time& time);
+};
+
+} /* namespace ptu */
+
+#endif /* STATE_PUBLISHER_H_ */
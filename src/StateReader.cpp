@@ -0,0 +1,141 @@
+/**
+  * Lock-free access to the head state published by a StatePublisher.
+  * @file StateReader.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "StateReader.h"
+using namespace ptu;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+void StateReader::map() {
+    int fd = shm_open(mName.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("StateReader: no shared memory named " + mName);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(SharedStateHeader)) {
+        ::close(fd);
+        throw std::runtime_error("StateReader: " + mName + " is not a state segment");
+    }
+
+    void* memory = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("StateReader: cannot map shared memory " + mName);
+    }
+
+    const SharedStateHeader* header = static_cast<const SharedStateHeader*>(memory);
+    bool valid = memcmp(header->magic, SHARED_STATE_MAGIC, sizeof(header->magic)) == 0;
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+
+    if (!valid || header->version != SHARED_STATE_VERSION || header->capacity == 0 ||
+            sharedStateSize(header->capacity) > size_t(info.st_size)) {
+        munmap(memory, info.st_size);
+        throw std::runtime_error("StateReader: " + mName + " is not a state segment of version " +
+                                 "this reader understands");
+    }
+
+    mHeader = header;
+    mSlots = sharedStateSlots(header);
+    mSize = info.st_size;
+}
+
+void StateReader::unmap() {
+    if (mHeader != 0) {
+        munmap(const_cast<SharedStateHeader*>(mHeader), mSize);
+        mHeader = 0;
+        mSlots = 0;
+    }
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+StateReader::StateReader(const string& name) :
+        mName(name),
+        mHeader(0),
+        mSlots(0),
+        mSize(0)
+{
+    map();
+}
+
+StateReader::~StateReader() {
+    unmap();
+}
+
+void StateReader::reopen() {
+    unmap();
+    map();
+}
+
+bool StateReader::read(uint64_t index, StateSample& sample) const {
+    const SharedStateSlot& slot = mSlots[index % mHeader->capacity];
+
+    uint64_t sequence = slot.sequence.load(boost::memory_order_acquire);
+    if (sequence != 2 * index + 2) {
+        return false;
+    }
+
+    sample = slot.sample;
+
+    // the copy is only valid if no write started meanwhile
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    return slot.sequence.load(boost::memory_order_relaxed) == sequence;
+}
+
+bool StateReader::latest(StateSample& sample) const {
+    while (true) {
+        uint64_t published = getPublished();
+        if (published == 0) {
+            return false;
+        }
+        if (read(published - 1, sample)) {
+            return true;
+        }
+        // lapped by the publisher while copying, take the newer one
+    }
+}
+
+size_t StateReader::recent(vector<StateSample>& samples, size_t count) const {
+    uint64_t published = getPublished();
+    uint64_t first = published - std::min<uint64_t>(published, std::min<uint64_t>(count, mHeader->capacity));
+
+    samples.clear();
+    return since(first, samples);
+}
+
+size_t StateReader::since(uint64_t& next, vector<StateSample>& samples) const {
+    uint64_t published = getPublished();
+
+    // older samples are gone already
+    if (published > next && published - next > mHeader->capacity) {
+        next = published - mHeader->capacity;
+    }
+
+    size_t appended = 0;
+    StateSample sample;
+    for (; next < published; ++next) {
+        if (read(next, sample)) {
+            samples.push_back(sample);
+            ++appended;
+        }
+    }
+    return appended;
+}
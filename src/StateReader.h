@@ -0,0 +1,95 @@
+/**
+  * Lock-free access to the head state published by a StatePublisher.
+  * @file StateReader.h
+  */
+
+#ifndef STATE_READER_H_
+#define STATE_READER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <string>
+#include <vector>
+
+#include "SharedState.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Reads the samples of a StatePublisher from another process.
+ *
+ * The segment is mapped read-only and read in place: getting a sample copies
+ * its few bytes out of the ring and checks the slot sequence before and
+ * after, no lock is taken and the publisher is never slowed down. Neither
+ * the driver nor the serial port are involved, so the reader library only
+ * depends on boost atomics and librt.
+ *
+ * A reader stays attached to the segment it opened. If the publishing
+ * process restarts, getPublished() stops advancing; call reopen().
+ */
+class StateReader {
+private:
+    std::string mName;
+    const SharedStateHeader* mHeader;
+    const SharedStateSlot* mSlots;
+    size_t mSize;
+
+    void map();
+    void unmap();
+
+    // non-copyable
+    StateReader(const StateReader&);
+    StateReader& operator=(const StateReader&);
+
+public:
+    /**
+     * Maps the segment \p name created by a StatePublisher.
+     * @throws std::runtime_error if it does not exist or is not a state segment
+     */
+    explicit StateReader(const std::string& name);
+    ~StateReader();
+
+    /** Maps the segment again, e.g. after the publisher restarted. */
+    void reopen();
+
+    /** Number of samples published so far; the newest has index getPublished() - 1. */
+    uint64_t getPublished() const { return mHeader->published.load(boost::memory_order_acquire); }
+
+    /** Number of samples kept in the ring. */
+    uint32_t getCapacity() const { return mHeader->capacity; }
+
+    /**
+     * Copies the sample \p index.
+     * @return false if it is not published yet, was overwritten or is being
+     *         written right now
+     */
+    bool read(uint64_t index, StateSample& sample) const;
+
+    /**
+     * Copies the newest sample.
+     * @return false if nothing was published yet
+     */
+    bool latest(StateSample& sample) const;
+
+    /**
+     * Copies up to \p count of the newest samples, oldest first.
+     * @return the number of samples copied
+     */
+    size_t recent(std::vector<StateSample>& samples, size_t count) const;
+
+    /**
+     * Appends the samples published since \p next to \p samples and
+     * advances \p next past them. Start with next = 0 or getPublished().
+     * Samples overwritten before they were read are skipped.
+     * @return the number of samples appended
+     */
+    size_t since(uint64_t& next, std::vector<StateSample>& samples) const;
+};
+
+} /* namespace ptu */
+
+#endif /* STATE_READER_H_ */
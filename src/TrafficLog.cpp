@@ -0,0 +1,176 @@
+/**
+  * Binary log of the raw traffic exchanged with the Pan-Tilt Unit.
+  * @file TrafficLog.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "TrafficLog.h"
+using namespace ptu;
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+//==============================================================================
+// Static members initialization
+//==============================================================================
+const char TrafficLog::MAGIC[8]  = { 'P', 'T', 'U', 'L', 'O', 'G', '\0', '\0' };
+const uint32_t TrafficLog::VERSION = 1;
+
+//==============================================================================
+// TrafficLog
+//==============================================================================
+uint64_t TrafficLog::monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+size_t TrafficLog::recordSize(uint32_t payloadSize) {
+    return sizeof(TrafficLogRecord) + ((size_t(payloadSize) + 7) & ~size_t(7));
+}
+
+//==============================================================================
+// TrafficLogWriter
+//==============================================================================
+TrafficLogWriter::TrafficLogWriter(const string& path) :
+        mFile(fopen(path.c_str(), "wb")),
+        mStartNs(TrafficLog::monotonicNs())
+{
+    if (mFile == 0) {
+        throw std::runtime_error("TrafficLogWriter: cannot create " + path + ": " + strerror(errno));
+    }
+
+    TrafficLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TrafficLog::MAGIC, sizeof(header.magic));
+    header.version = TrafficLog::VERSION;
+    header.startNs = mStartNs;
+
+    if (fwrite(&header, sizeof(header), 1, mFile) != 1) {
+        fclose(mFile);
+        mFile = 0;
+        throw std::runtime_error("TrafficLogWriter: cannot write header to " + path);
+    }
+}
+
+TrafficLogWriter::~TrafficLogWriter() {
+    close();
+}
+
+bool TrafficLogWriter::append(Direction direction, const uint8_t* data, size_t size) {
+    boost::mutex::scoped_lock lock(mMutex);
+    if (mFile == 0 || size == 0) {
+        return true;
+    }
+
+    static const uint8_t padding[8] = { 0 };
+
+    TrafficLogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timeNs = TrafficLog::monotonicNs() - mStartNs;
+    record.size = uint32_t(size);
+    record.direction = uint8_t(direction);
+
+    size_t paddingSize = TrafficLog::recordSize(record.size) - sizeof(record) - size;
+    if (fwrite(&record, sizeof(record), 1, mFile) != 1 ||
+            fwrite(data, 1, size, mFile) != size ||
+            fwrite(padding, 1, paddingSize, mFile) != paddingSize ||
+            fflush(mFile) != 0) {
+        closeLocked();
+        return false;
+    }
+    return true;
+}
+
+bool TrafficLogWriter::close() {
+    boost::mutex::scoped_lock lock(mMutex);
+    return closeLocked();
+}
+
+bool TrafficLogWriter::isOpen() const {
+    boost::mutex::scoped_lock lock(mMutex);
+    return mFile != 0;
+}
+
+bool TrafficLogWriter::closeLocked() {
+    if (mFile == 0) {
+        return true;
+    }
+
+    bool written = fclose(mFile) == 0;
+    mFile = 0;
+    return written;
+}
+
+//==============================================================================
+// TrafficLogReader
+//==============================================================================
+TrafficLogReader::TrafficLogReader(const string& path) :
+        mFd(open(path.c_str(), O_RDONLY)),
+        mData(0),
+        mSize(0),
+        mOffset(sizeof(TrafficLogHeader))
+{
+    if (mFd < 0) {
+        throw std::runtime_error("TrafficLogReader: cannot open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(mFd, &st) != 0 || size_t(st.st_size) < sizeof(TrafficLogHeader)) {
+        ::close(mFd);
+        throw std::runtime_error("TrafficLogReader: " + path + " is too short to be a traffic log");
+    }
+    mSize = st.st_size;
+
+    void* data = mmap(0, mSize, PROT_READ, MAP_PRIVATE, mFd, 0);
+    if (data == MAP_FAILED) {
+        ::close(mFd);
+        throw std::runtime_error("TrafficLogReader: cannot map " + path + ": " + strerror(errno));
+    }
+    mData = static_cast<const uint8_t*>(data);
+
+    if (memcmp(header().magic, TrafficLog::MAGIC, sizeof(TrafficLog::MAGIC)) != 0 ||
+            header().version != TrafficLog::VERSION) {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+        ::close(mFd);
+        throw std::runtime_error("TrafficLogReader: " + path + " is not a supported traffic log");
+    }
+}
+
+TrafficLogReader::~TrafficLogReader() {
+    munmap(const_cast<uint8_t*>(mData), mSize);
+    ::close(mFd);
+}
+
+const TrafficLogHeader& TrafficLogReader::header() const {
+    return *reinterpret_cast<const TrafficLogHeader*>(mData);
+}
+
+const TrafficLogRecord* TrafficLogReader::next(const uint8_t*& payload) {
+    if (mOffset + sizeof(TrafficLogRecord) > mSize) {
+        return 0;
+    }
+
+    const TrafficLogRecord* record = reinterpret_cast<const TrafficLogRecord*>(mData + mOffset);
+    if (mOffset + sizeof(TrafficLogRecord) + record->size > mSize) {
+        return 0;
+    }
+
+    payload = mData + mOffset + sizeof(TrafficLogRecord);
+    mOffset += TrafficLog::recordSize(record->size);
+    return record;
+}
+
+void TrafficLogReader::rewind() {
+    mOffset = sizeof(TrafficLogHeader);
+}
@@ -0,0 +1,144 @@
+/**
+  * Binary log of the raw traffic exchanged with the Pan-Tilt Unit.
+  * @file TrafficLog.h
+  */
+
+#ifndef TRAFFIC_LOG_H_
+#define TRAFFIC_LOG_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <cstdio>
+#include <string>
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Direction of a logged chunk, as seen from the host.
+ */
+enum Direction {
+    OUTBOUND, INBOUND
+};
+
+/**
+ * File header of a traffic log. All fields are host endian, the log is meant
+ * to be replayed on the machine (or architecture) that recorded it.
+ */
+struct TrafficLogHeader {
+    char magic[8];          //!< Always TrafficLog::MAGIC.
+    uint32_t version;       //!< Format version, TrafficLog::VERSION.
+    uint32_t reserved;
+    uint64_t startNs;       //!< CLOCK_MONOTONIC time at which recording started.
+};
+
+/**
+ * Header of one logged chunk. It is followed by \c size payload bytes, padded
+ * with zeros to the next multiple of 8 so that every record stays aligned
+ * when the log is memory mapped.
+ */
+struct TrafficLogRecord {
+    uint64_t timeNs;        //!< Time since TrafficLogHeader::startNs.
+    uint32_t size;          //!< Number of payload bytes.
+    uint8_t direction;      //!< A Direction value.
+    uint8_t reserved[3];
+};
+
+class TrafficLog {
+public:
+    static const char MAGIC[8];         //!< Magic bytes starting every log.
+    static const uint32_t VERSION;      //!< The current format version.
+
+    /** Current CLOCK_MONOTONIC time in nanoseconds. */
+    static uint64_t monotonicNs();
+
+    /** Size of a record including its payload and padding. */
+    static size_t recordSize(uint32_t payloadSize);
+};
+
+/**
+ * Appends chunks to a traffic log file. Appends and close may come from
+ * different threads, e.g. the I/O thread of the scheduler recording while
+ * the driver stops the recording.
+ */
+class TrafficLogWriter {
+private:
+    FILE* mFile;
+    uint64_t mStartNs;
+    mutable boost::mutex mMutex;    //!< Guards mFile.
+
+    /** Closes the log, with mMutex held. */
+    bool closeLocked();
+
+    // non-copyable
+    TrafficLogWriter(const TrafficLogWriter&);
+    TrafficLogWriter& operator=(const TrafficLogWriter&);
+
+public:
+    /**
+     * Creates (or truncates) the log at \p path and writes its header.
+     * @throws std::runtime_error if the file cannot be created
+     */
+    explicit TrafficLogWriter(const std::string& path);
+    ~TrafficLogWriter();
+
+    /**
+     * Logs \p size bytes of \p data, timestamped with the current time, and
+     * flushes it so that a crash does not lose the tail of the log.
+     * @return false if the record could not be written; the log is closed
+     *         then and further appends are ignored (and return true)
+     */
+    bool append(Direction direction, const uint8_t* data, size_t size);
+
+    /**
+     * Flushes and closes the log. Further appends are ignored.
+     * @return false if the pending records could not be written
+     */
+    bool close();
+
+    bool isOpen() const;
+};
+
+/**
+ * Read-only, memory mapped view of a traffic log.
+ */
+class TrafficLogReader {
+private:
+    int mFd;
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mOffset;
+
+    // non-copyable
+    TrafficLogReader(const TrafficLogReader&);
+    TrafficLogReader& operator=(const TrafficLogReader&);
+
+public:
+    /**
+     * Maps the log at \p path and validates its header.
+     * @throws std::runtime_error if the file is missing or not a traffic log
+     */
+    explicit TrafficLogReader(const std::string& path);
+    ~TrafficLogReader();
+
+    const TrafficLogHeader& header() const;
+
+    /**
+     * Returns the next record and sets \p payload to its bytes, or returns 0
+     * at the end of the log. A truncated last record is treated as the end.
+     */
+    const TrafficLogRecord* next(const uint8_t*& payload);
+
+    /** Restarts iteration at the first record. */
+    void rewind();
+};
+
+} /* namespace ptu */
+
+#endif /* TRAFFIC_LOG_H_ */
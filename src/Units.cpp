@@ -0,0 +1,104 @@
+/**
+  * Conversion between device positions (ticks) and angles.
+  * @file Units.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "Units.h"
+using namespace ptu;
+
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// AxisUnits
+//==============================================================================
+AxisUnits::AxisUnits(double resolutionDeg) {
+    setResolutionDeg(resolutionDeg);
+}
+
+void AxisUnits::setResolutionDeg(double resolutionDeg) {
+    if (!(resolutionDeg > 0)) {
+        throw std::runtime_error("AxisUnits: resolution must be positive");
+    }
+
+    mDegPerTick = resolutionDeg;
+    mTicksPerDeg = 1.0 / resolutionDeg;
+    mRadPerTick = resolutionDeg * M_PI / 180.0;
+    mTicksPerRad = 1.0 / mRadPerTick;
+}
+
+void AxisUnits::radToTicks(const double* rad, int* ticks, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+        ticks[i] = radToTicks(rad[i]);
+    }
+}
+
+void AxisUnits::ticksToRad(const int* ticks, double* rad, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+        rad[i] = ticksToRad(ticks[i]);
+    }
+}
+
+void AxisUnits::radToTicks(const vector<double>& rad, vector<int>& ticks) const {
+    ticks.resize(rad.size());
+    if (!rad.empty()) {
+        radToTicks(&rad[0], &ticks[0], rad.size());
+    }
+}
+
+void AxisUnits::ticksToRad(const vector<int>& ticks, vector<double>& rad) const {
+    rad.resize(ticks.size());
+    if (!ticks.empty()) {
+        ticksToRad(&ticks[0], &rad[0], ticks.size());
+    }
+}
+
+//==============================================================================
+// Units
+//==============================================================================
+Units::Units(double panResolutionDeg, double tiltResolutionDeg) :
+        mPan(panResolutionDeg),
+        mTilt(tiltResolutionDeg)
+{}
+
+void Units::toTicks(const vector<PanTiltRad>& rad, vector<PanTiltTicks>& ticks) const {
+    ticks.resize(rad.size());
+    for (size_t i = 0; i < rad.size(); ++i) {
+        ticks[i] = toTicks(rad[i]);
+    }
+}
+
+void Units::toRad(const vector<PanTiltTicks>& ticks, vector<PanTiltRad>& rad) const {
+    rad.resize(ticks.size());
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        rad[i] = toRad(ticks[i]);
+    }
+}
+
+void Units::grid(double panFrom, double panTo, size_t panCount,
+                 double tiltFrom, double tiltTo, size_t tiltCount,
+                 vector<PanTiltTicks>& ticks) const
+{
+    vector<double> panRad(panCount), tiltRad(tiltCount);
+    vector<int> panTicks, tiltTicks;
+
+    for (size_t i = 0; i < panCount; ++i) {
+        panRad[i] = panCount > 1 ? panFrom + (panTo - panFrom) * i / (panCount - 1) : panFrom;
+    }
+    for (size_t i = 0; i < tiltCount; ++i) {
+        tiltRad[i] = tiltCount > 1 ? tiltFrom + (tiltTo - tiltFrom) * i / (tiltCount - 1) : tiltFrom;
+    }
+
+    mPan.radToTicks(panRad, panTicks);
+    mTilt.radToTicks(tiltRad, tiltTicks);
+
+    ticks.resize(panCount * tiltCount);
+    for (size_t t = 0; t < tiltCount; ++t) {
+        for (size_t p = 0; p < panCount; ++p) {
+            ticks[t * panCount + p] = PanTiltTicks(panTicks[p], tiltTicks[t]);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/**
+  * Conversion between device positions (ticks) and angles.
+  * @file Units.h
+  */
+
+#ifndef UNITS_H_
+#define UNITS_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "Cmd.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * A pan/tilt pair of angles in radians.
+ */
+struct PanTiltRad {
+    double pan;
+    double tilt;
+
+    PanTiltRad() : pan(0), tilt(0) {}
+    PanTiltRad(double p, double t) : pan(p), tilt(t) {}
+};
+
+/**
+ * A pan/tilt pair of device positions.
+ */
+struct PanTiltTicks {
+    int pan;
+    int tilt;
+
+    PanTiltTicks() : pan(0), tilt(0) {}
+    PanTiltTicks(int p, int t) : pan(p), tilt(t) {}
+};
+
+/**
+ * Conversions for one axis, driven by the axis resolution.
+ *
+ * Angles are rounded to the nearest tick. The batch methods use the very same
+ * inline conversion as the scalar ones, so a trajectory converted in bulk
+ * yields exactly the ticks the driver sends for each of its points.
+ */
+class AxisUnits {
+private:
+    double mDegPerTick;
+    double mTicksPerDeg;
+    double mRadPerTick;
+    double mTicksPerRad;
+
+    static int roundToInt(double val) { return int(std::floor(val + 0.5)); }
+
+public:
+    /** @param resolutionDeg the axis resolution in deg/position */
+    explicit AxisUnits(double resolutionDeg = 1.0);
+
+    /** Sets the axis resolution in deg/position. */
+    void setResolutionDeg(double resolutionDeg);
+    double getResolutionDeg() const { return mDegPerTick; }
+
+    // positions and angles
+    int degToTicks(double deg) const { return roundToInt(deg * mTicksPerDeg); }
+    int radToTicks(double rad) const { return roundToInt(rad * mTicksPerRad); }
+    double ticksToDeg(int ticks) const { return ticks * mDegPerTick; }
+    double ticksToRad(int ticks) const { return ticks * mRadPerTick; }
+
+    // speeds (positions/sec) and accelerations (positions/sec^2) scale alike
+    int degPerSecToTicks(double deg) const { return degToTicks(deg); }
+    int radPerSecToTicks(double rad) const { return radToTicks(rad); }
+    double ticksToDegPerSec(int ticks) const { return ticksToDeg(ticks); }
+    double ticksToRadPerSec(int ticks) const { return ticksToRad(ticks); }
+
+    /** Converts \p count angles from \p rad into \p ticks. */
+    void radToTicks(const double* rad, int* ticks, size_t count) const;
+    /** Converts \p count positions from \p ticks into \p rad. */
+    void ticksToRad(const int* ticks, double* rad, size_t count) const;
+
+    void radToTicks(const std::vector<double>& rad, std::vector<int>& ticks) const;
+    void ticksToRad(const std::vector<int>& ticks, std::vector<double>& rad) const;
+};
+
+/**
+ * Conversions for both axes of the unit.
+ */
+class Units {
+private:
+    AxisUnits mPan;
+    AxisUnits mTilt;
+
+public:
+    Units(double panResolutionDeg = 1.0, double tiltResolutionDeg = 1.0);
+
+    const AxisUnits& axis(const Axis& axis) const { return axis == TILT ? mTilt : mPan; }
+    AxisUnits& axis(const Axis& axis) { return axis == TILT ? mTilt : mPan; }
+
+    PanTiltTicks toTicks(const PanTiltRad& rad) const {
+        return PanTiltTicks(mPan.radToTicks(rad.pan), mTilt.radToTicks(rad.tilt));
+    }
+
+    PanTiltRad toRad(const PanTiltTicks& ticks) const {
+        return PanTiltRad(mPan.ticksToRad(ticks.pan), mTilt.ticksToRad(ticks.tilt));
+    }
+
+    /** Converts a whole trajectory or scan grid to device positions. */
+    void toTicks(const std::vector<PanTiltRad>& rad, std::vector<PanTiltTicks>& ticks) const;
+    /** Converts a whole trajectory or scan grid of device positions to angles. */
+    void toRad(const std::vector<PanTiltTicks>& ticks, std::vector<PanTiltRad>& rad) const;
+
+    /**
+     * Builds a row-major scan grid covering [\p panFrom, \p panTo] x
+     * [\p tiltFrom, \p tiltTo] with the given number of points per axis,
+     * directly in device positions.
+     */
+    void grid(double panFrom, double panTo, size_t panCount,
+              double tiltFrom, double tiltTo, size_t tiltCount,
+              std::vector<PanTiltTicks>& ticks) const;
+};
+
+} /* namespace ptu */
+
+#endif /* UNITS_H_ */
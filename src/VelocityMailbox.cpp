@@ -0,0 +1,101 @@
+/**
+  * Latest-wins mailbox for pan/tilt speed setpoints.
+  * @file VelocityMailbox.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "VelocityMailbox.h"
+using namespace ptu;
+
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+
+//==============================================================================
+// Implementation
+//==============================================================================
+VelocityMailbox::VelocityMailbox() :
+        mPending(false),
+        mPosted(0),
+        mDropped(0),
+        mSent(0)
+{
+    mSlot[PAN].store(0);
+    mSlot[TILT].store(0);
+    mTaken[PAN] = 0;
+    mTaken[TILT] = 0;
+
+    if (sem_init(&mSignal, 0, 0) != 0) {
+        throw std::runtime_error("VelocityMailbox: cannot create semaphore");
+    }
+}
+
+VelocityMailbox::~VelocityMailbox() {
+    sem_destroy(&mSignal);
+}
+
+void VelocityMailbox::post(const Axis& axis, int speed) {
+    boost::atomic<uint64_t>& slot = mSlot[axis == TILT ? TILT : PAN];
+
+    uint64_t old = slot.load(boost::memory_order_relaxed);
+    uint64_t val;
+    do {
+        uint64_t seq = (old >> 32) + 1;
+        val = (seq << 32) | uint32_t(speed);
+    } while (!slot.compare_exchange_weak(old, val, boost::memory_order_release,
+                                         boost::memory_order_relaxed));
+
+    mPosted.fetch_add(1, boost::memory_order_relaxed);
+
+    // wake the consumer once per batch of posts
+    if (!mPending.exchange(true, boost::memory_order_acq_rel)) {
+        sem_post(&mSignal);
+    }
+}
+
+bool VelocityMailbox::take(const Axis& axis, int& speed) {
+    int i = axis == TILT ? TILT : PAN;
+
+    uint64_t val = mSlot[i].load(boost::memory_order_acquire);
+    uint32_t seq = uint32_t(val >> 32);
+
+    if (seq == mTaken[i]) {
+        return false;
+    }
+
+    mDropped.fetch_add(uint32_t(seq - mTaken[i] - 1), boost::memory_order_relaxed);
+    mTaken[i] = seq;
+    speed = int32_t(uint32_t(val));
+    return true;
+}
+
+void VelocityMailbox::retry(const Axis& axis) {
+    int i = axis == TILT ? TILT : PAN;
+
+    // the next take() returns the newest setpoint again, and counts the
+    // failed one as dropped if a newer one was posted meanwhile
+    mTaken[i] = mTaken[i] - 1;
+}
+
+bool VelocityMailbox::wait(const base::Time& timeout) {
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    int64_t ns = deadline.tv_nsec + (timeout.toMicroseconds() % 1000000) * 1000;
+    deadline.tv_sec += timeout.toMicroseconds() / 1000000 + ns / 1000000000;
+    deadline.tv_nsec = ns % 1000000000;
+
+    while (sem_timedwait(&mSignal, &deadline) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    // an exchange, unlike a plain store, keeps the following take() from
+    // reading the slots before the flag is cleared; a post racing with this
+    // either is seen by take() or sets the flag again and posts the semaphore
+    mPending.exchange(false, boost::memory_order_acq_rel);
+    return true;
+}
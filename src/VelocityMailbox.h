@@ -0,0 +1,94 @@
+/**
+  * Latest-wins mailbox for pan/tilt speed setpoints.
+  * @file VelocityMailbox.h
+  */
+
+#ifndef VELOCITY_MAILBOX_H_
+#define VELOCITY_MAILBOX_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <stdint.h>
+#include <semaphore.h>
+
+#include <boost/atomic.hpp>
+#include <base/Time.hpp>
+
+#include "Cmd.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+/**
+ * Hands speed setpoints from fast producers (e.g. a visual tracker) to the
+ * thread that talks to the unit, without ever queueing them.
+ *
+ * Each axis has a single slot holding the newest setpoint together with a
+ * sequence number. post() replaces the slot lock-free and never blocks; the
+ * I/O side only ever sends the newest unsent setpoint of each axis (see
+ * Driver::sendMailboxSpeeds), and setpoints overwritten before being taken
+ * are counted as dropped. The command latency is thus bounded by one speed
+ * round trip per axis, however fast setpoints are posted.
+ */
+class VelocityMailbox {
+private:
+    boost::atomic<uint64_t> mSlot[2];       //!< sequence << 32 | speed, per axis
+    boost::atomic<bool> mPending;           //!< a post happened since the last wait
+    uint32_t mTaken[2];                     //!< last sequence taken, consumer side only
+    boost::atomic<uint64_t> mPosted;
+    boost::atomic<uint64_t> mDropped;
+    boost::atomic<uint64_t> mSent;
+    sem_t mSignal;
+
+    // non-copyable
+    VelocityMailbox(const VelocityMailbox&);
+    VelocityMailbox& operator=(const VelocityMailbox&);
+
+public:
+    VelocityMailbox();
+    ~VelocityMailbox();
+
+    /**
+     * Posts a new speed setpoint in positions/sec for \p axis, superseding
+     * any setpoint not sent yet. Lock-free, may be called from any thread.
+     */
+    void post(const Axis& axis, int speed);
+
+    /**
+     * Takes the newest setpoint of \p axis if one was posted since the
+     * last take. Must only be called from the consuming thread.
+     * @return false if there is nothing new to send
+     */
+    bool take(const Axis& axis, int& speed);
+
+    /**
+     * Gives back the setpoint last taken from \p axis because it could not
+     * be sent, so that the next take() returns the newest setpoint again.
+     * Must only be called from the consuming thread.
+     */
+    void retry(const Axis& axis);
+
+    /** Records that a taken setpoint reached the unit. */
+    void markSent() { mSent.fetch_add(1, boost::memory_order_relaxed); }
+
+    /**
+     * Blocks the consuming thread until something is posted or \p timeout
+     * elapses.
+     * @return true if a setpoint may be available
+     */
+    bool wait(const base::Time& timeout);
+
+    /** Number of setpoints posted so far. */
+    uint64_t getPostedCount() const { return mPosted.load(boost::memory_order_relaxed); }
+    /** Number of setpoints superseded before they could be sent. */
+    uint64_t getDroppedCount() const { return mDropped.load(boost::memory_order_relaxed); }
+    /** Number of setpoints sent to the unit. */
+    uint64_t getSentCount() const { return mSent.load(boost::memory_order_relaxed); }
+};
+
+} /* namespace ptu */
+
+#endif /* VELOCITY_MAILBOX_H_ */
@@ -0,0 +1,213 @@
+/**
+  * Non-stop execution of waypoint paths.
+  * @file WaypointExecutor.cpp
+  */
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include "WaypointExecutor.h"
+#include "CommandScheduler.h"
+#include "Driver.h"
+using namespace ptu;
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+using namespace std;
+
+//==============================================================================
+// WaypointOptions
+//==============================================================================
+WaypointOptions::WaypointOptions() :
+        cornerTolerance(50),
+        lead(base::Time::fromMilliseconds(20)),
+        pollPeriod(base::Time::fromMilliseconds(20)),
+        stallTimeout(base::Time::fromMilliseconds(200))
+{}
+
+//==============================================================================
+// Private methods implementation
+//==============================================================================
+int WaypointExecutor::distance(Axis axis, int from, int to, int turn) const {
+    int diff = to - from;
+    if (axis == PAN && turn > 0) {
+        diff = ((diff % turn) + turn + turn / 2) % turn - turn / 2;
+    }
+    return diff;
+}
+
+bool WaypointExecutor::halted(unsigned halts) {
+    boost::shared_ptr<CommandScheduler> scheduler = mDriver.getScheduler();
+    return scheduler != 0 && scheduler->getHaltCount() != halts;
+}
+
+bool WaypointExecutor::approach(const PanTiltTicks& target, const MotionModel& model, int turn,
+                                unsigned halts, const base::Time& deadline) {
+    PanTiltTicks last;
+    base::Time lastTime;
+    base::Time lastChange = base::Time::now();
+
+    while (true) {
+        if (halted(halts)) {
+            return false;
+        }
+
+        PanTiltTicks pos(mDriver.getPos(PAN, false), mDriver.getPos(TILT, false));
+        base::Time now = base::Time::now();
+
+        if (lastTime.isNull() || pos.pan != last.pan || pos.tilt != last.tilt) {
+            lastChange = now;
+        }
+
+        // seconds until both axes are within their switch distance
+        double wait = 0;
+        for (int i = 0; i < 2; ++i) {
+            Axis axis = i == 0 ? PAN : TILT;
+            const AxisMotion& motion = model.axis(axis);
+            int remaining = abs(distance(axis, i == 0 ? pos.pan : pos.tilt,
+                                         i == 0 ? target.pan : target.tilt, turn));
+
+            double speed = 0;
+            if (!lastTime.isNull()) {
+                int moved = distance(axis, i == 0 ? last.pan : last.tilt, i == 0 ? pos.pan : pos.tilt, turn);
+                speed = std::min(abs(moved) / (now - lastTime).toSeconds(), motion.speed);
+            }
+
+            double brake = speed > motion.baseSpeed && motion.accel > 0
+                    ? (speed * speed - motion.baseSpeed * motion.baseSpeed) / (2 * motion.accel) : 0;
+            double window = std::min<double>(mOptions.cornerTolerance,
+                                             brake + speed * mOptions.lead.toSeconds());
+
+            if (remaining > window) {
+                // without a speed estimate yet, only the polls decide
+                wait = std::max(wait, speed > 0 ? (remaining - window) / speed : HUGE_VAL);
+            }
+        }
+
+        if (wait == 0) {
+            return true;
+        }
+
+        if (now - lastChange > mOptions.stallTimeout) {
+            throw std::runtime_error("WaypointExecutor: the head stopped short of a waypoint");
+        }
+        if (now > deadline) {
+            throw std::runtime_error("WaypointExecutor: a waypoint was not reached within its move deadline");
+        }
+
+        if (wait <= mOptions.pollPeriod.toSeconds()) {
+            boost::this_thread::sleep(boost::posix_time::microseconds(int64_t(wait * 1e6)));
+            return !halted(halts);
+        }
+
+        last = pos;
+        lastTime = now;
+        boost::this_thread::sleep(boost::posix_time::microseconds(mOptions.pollPeriod.toMicroseconds()));
+    }
+}
+
+bool WaypointExecutor::follow(const vector<PanTiltTicks>& waypoints) {
+    boost::shared_ptr<CommandScheduler> scheduler = mDriver.getScheduler();
+    unsigned halts = scheduler != 0 ? scheduler->getHaltCount() : 0;
+
+    MotionModel model = mDriver.getMotionModel();
+    MovePredictor predictor = mDriver.getPredictor();
+    int turn = mDriver.isContinuousPan() ? mDriver.getUnits().axis(PAN).radToTicks(2 * M_PI) : 0;
+
+    for (int i = 0; i < 2 && mOptions.cornerTolerance > 0 && waypoints.size() > 1; ++i) {
+        const AxisMotion& motion = model.axis(i == 0 ? PAN : TILT);
+        double brake = motion.speed > motion.baseSpeed && motion.accel > 0
+                ? (motion.speed * motion.speed - motion.baseSpeed * motion.baseSpeed) / (2 * motion.accel) : 0;
+        if (brake > mOptions.cornerTolerance) {
+            LOG_WARN_S << "WaypointExecutor: the " << (i == 0 ? "pan" : "tilt") << " axis brakes over "
+                       << int(brake) << " positions at full speed, more than the corner tolerance of "
+                       << mOptions.cornerTolerance << ": it slows down before turning";
+        }
+    }
+
+    PanTiltTicks from(mDriver.getPos(PAN, false), mDriver.getPos(TILT, false));
+
+    for (size_t i = 0; i + 1 < waypoints.size(); ++i) {
+        if (mOptions.cornerTolerance == 0) {
+            if (!mDriver.setPos(waypoints[i], true)) {
+                return false;
+            }
+            continue;
+        }
+
+        const PanTiltTicks& to = waypoints[i];
+        double seconds = std::max(predictor.duration(PAN, distance(PAN, from.pan, to.pan, turn)),
+                                  predictor.duration(TILT, to.tilt - from.tilt));
+        base::Time deadline = base::Time::now() + mDriver.getMoveDeadline(seconds);
+
+        mDriver.setPos(to, false);
+        if (!approach(to, model, turn, halts, deadline)) {
+            return false;
+        }
+        from = to;
+    }
+
+    if (halted(halts)) {
+        return false;
+    }
+    return mDriver.setPos(waypoints.back(), true);
+}
+
+//==============================================================================
+// Public methods implementation
+//==============================================================================
+WaypointExecutor::WaypointExecutor(Driver& driver, const WaypointOptions& options) :
+        mDriver(driver)
+{
+    setOptions(options);
+}
+
+void WaypointExecutor::setOptions(const WaypointOptions& options) {
+    if (options.cornerTolerance < 0) {
+        throw std::runtime_error("WaypointExecutor: the corner tolerance must not be negative");
+    }
+    if (options.pollPeriod.toMicroseconds() <= 0) {
+        throw std::runtime_error("WaypointExecutor: the poll period must be positive");
+    }
+    if (options.stallTimeout <= options.pollPeriod) {
+        throw std::runtime_error("WaypointExecutor: the stall timeout must exceed the poll period");
+    }
+    mOptions = options;
+}
+
+bool WaypointExecutor::run(const vector<PanTiltTicks>& waypoints) {
+    if (waypoints.empty()) {
+        return true;
+    }
+    if (mOptions.cornerTolerance > 0 && mDriver.getMotionGuard().getZoneCount() > 0) {
+        throw std::runtime_error("WaypointExecutor: blended corners are not checked against the "
+                                 "keep-out zones, use a corner tolerance of 0");
+    }
+
+    bool immediate = mDriver.isImmediatePosExec();
+    mDriver.setImmediatePosExec(true);
+
+    bool done;
+    try {
+        done = follow(waypoints);
+    } catch (...) {
+        // the original error matters more than a failing restore
+        try {
+            if (!immediate) {
+                mDriver.setImmediatePosExec(false);
+            }
+        } catch (std::exception& e) {
+            LOG_ERROR_S << "WaypointExecutor: cannot restore slaved execution: " << e.what();
+        }
+        throw;
+    }
+
+    if (!immediate) {
+        mDriver.setImmediatePosExec(false);
+    }
+    return done;
+}
@@ -0,0 +1,121 @@
+/**
+  * Non-stop execution of waypoint paths.
+  * @file WaypointExecutor.h
+  */
+
+#ifndef WAYPOINT_EXECUTOR_H_
+#define WAYPOINT_EXECUTOR_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+#include <vector>
+
+#include <base/Time.hpp>
+
+#include "MotionModel.h"
+
+//==============================================================================
+// Declaration
+//==============================================================================
+namespace ptu {
+
+class Driver;
+
+/**
+ * Options of the WaypointExecutor.
+ */
+struct WaypointOptions {
+    /**
+     * How far (in positions, per axis) the head may be from an intermediate
+     * waypoint when it turns towards the next one, 50 by default. That is
+     * far less than the braking distance at typical speeds (250 positions at
+     * 1000 positions/sec and 2000 positions/sec^2), so the default corners
+     * are tight and the head still slows down into them; raise it to the
+     * braking distance for corners taken at full speed. 0 stops at every
+     * waypoint, which is required with keep-out zones: blended corners are
+     * not checked against them.
+     */
+    int cornerTolerance;
+    /** Time from sending a target until the unit acts on it, 20ms by default. */
+    base::Time lead;
+    /** Longest time between two position polls, 20ms by default. */
+    base::Time pollPeriod;
+    /**
+     * Longest time the position may stay unchanged short of a waypoint
+     * before the path fails, 200ms by default.
+     */
+    base::Time stallTimeout;
+
+    WaypointOptions();
+};
+
+/**
+ * Moves through a list of waypoints without stopping at the intermediate
+ * ones.
+ *
+ * The unit runs in immediate position execution mode, where a new target
+ * replaces the current one mid-motion. While the head approaches an
+ * intermediate waypoint, the executor polls its position, estimates its
+ * speed from consecutive polls and sends the next waypoint once both axes
+ * are within their switch distance of the current one: the distance the
+ * axis needs to brake from its current speed (motion model) plus the
+ * distance it covers during the lead time, but never more than the corner
+ * tolerance. The head thus turns towards the next waypoint instead of
+ * stopping on each one; it bends off before it starts to decelerate only if
+ * the corner tolerance covers the braking distance, which run() warns
+ * about otherwise. Between polls
+ * the executor sleeps until the predicted switch time, at most a poll
+ * period.
+ *
+ * The last waypoint is approached with an awaited move. With the scheduler
+ * running, a halt aborts the path. Each intermediate waypoint has to be
+ * reached within the move deadline of its leg (Driver::getMoveDeadline),
+ * and the head must not stop short of it for longer than the stall
+ * timeout. Otherwise the path fails. The previous execution mode is restored
+ * afterwards.
+ */
+class WaypointExecutor {
+private:
+    Driver& mDriver;
+    WaypointOptions mOptions;
+
+    /** Signed distance from \p from to \p to on \p axis, modulo a turn in continuous pan. */
+    int distance(Axis axis, int from, int to, int turn) const;
+
+    /**
+     * Polls until the head is close enough to \p target to head for the
+     * next waypoint.
+     * @param deadline when the head has to be there at the latest
+     * @return false if a halt aborted the path
+     * @throws std::runtime_error if the head stalled or missed \p deadline
+     */
+    bool approach(const PanTiltTicks& target, const MotionModel& model, int turn, unsigned halts,
+                  const base::Time& deadline);
+
+    /** Moves through \p waypoints, in immediate execution mode. */
+    bool follow(const std::vector<PanTiltTicks>& waypoints);
+
+    /** True if a halt was sent through the scheduler since \p halts. */
+    bool halted(unsigned halts);
+
+public:
+    explicit WaypointExecutor(Driver& driver, const WaypointOptions& options = WaypointOptions());
+
+    void setOptions(const WaypointOptions& options);
+    const WaypointOptions& getOptions() const { return mOptions; }
+
+    /**
+     * Enables immediate position execution and moves through \p waypoints,
+     * blending the intermediate ones.
+     * @return false if a halt aborted the path
+     * @throws std::runtime_error if the head stalled or missed a deadline,
+     *         or if the driver has keep-out zones and the corner tolerance
+     *         is not 0, before anything is sent
+     */
+    bool run(const std::vector<PanTiltTicks>& waypoints);
+};
+
+} /* namespace ptu */
+
+#endif /* WAYPOINT_EXECUTOR_H_ */
@@ -0,0 +1,323 @@
+// \file benchmark_ptu.cpp
+// Micro-benchmarks of the CPU side of the driver: command encoding, reply
+// framing, reply parsing and look-at solutions. Reports ns/op and heap
+// allocations/op.
+// Optionally measures query round trips against a pty standing in for the
+// unit: the host side latency of tty layer, iodrivers_base and driver. The
+// low latency serial settings are not compared here, a pty has neither the
+// low latency flag nor a latency timer and is opened raw either way.
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+
+#include <Driver.h>
+#include <Cmd.h>
+#include <LookAt.h>
+#include <SerialTuning.h>
+#include <TrafficLog.h>
+
+namespace po = boost::program_options;
+
+//==============================================================================
+// Allocation counting
+//==============================================================================
+static size_t gAllocations = 0;
+
+void* operator new(std::size_t size) {
+    ++gAllocations;
+    void* p = std::malloc(size ? size : 1);
+    if (p == 0)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+//==============================================================================
+// Harness
+//==============================================================================
+/** Exposes the framing of the driver, extractPacket is protected. */
+class FramingProbe : public ptu::Driver {
+public:
+    int extract(const uint8_t* buffer, size_t size) const { return extractPacket(buffer, size); }
+};
+
+static volatile long gSink = 0;    //!< keeps the results alive
+
+template<typename Op>
+void run(const std::string& name, Op op, size_t iterations) {
+    // warm up caches and lazily initialized statics
+    for (size_t i = 0; i < iterations / 10 + 1; ++i)
+        op();
+
+    size_t allocations = gAllocations;
+    uint64_t start = ptu::TrafficLog::monotonicNs();
+    for (size_t i = 0; i < iterations; ++i)
+        op();
+    uint64_t elapsed = ptu::TrafficLog::monotonicNs() - start;
+    allocations = gAllocations - allocations;
+
+    std::cout << std::left << std::setw(34) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1) << double(elapsed) / iterations << " ns/op"
+              << std::setw(8) << std::setprecision(2) << double(allocations) / iterations << " allocs/op"
+              << std::endl;
+}
+
+/**
+ * Feeds \p stream to the framing in chunks of \p chunk bytes the way
+ * iodrivers_base does: skip what the framing rejects, wait for more data
+ * while a packet is incomplete, consume complete packets.
+ */
+struct Framing {
+    const FramingProbe& probe;
+    std::string stream;
+    size_t chunk;
+
+    Framing(const FramingProbe& probe, const std::string& stream, size_t chunk) :
+        probe(probe), stream(stream), chunk(chunk) {}
+
+    void operator()() const {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(stream.data());
+        size_t begin = 0, end = 0;
+        bool starved = true;
+        long packets = 0;
+
+        while (true) {
+            if (starved || begin == end) {
+                if (end == stream.size())
+                    break;
+                end = std::min(end + chunk, stream.size());
+            }
+
+            int result = probe.extract(data + begin, end - begin);
+            starved = result == 0;
+            if (result < 0) {
+                begin += -result;
+            } else if (result > 0) {
+                begin += result;
+                ++packets;
+            }
+        }
+        gSink += packets;
+    }
+};
+
+//==============================================================================
+// Operations
+//==============================================================================
+struct GetPos { void operator()() const { gSink += ptu::Cmd::getPos(ptu::PAN).size(); } };
+struct SetPos { void operator()() const { gSink += ptu::Cmd::setPos(-123456, ptu::TILT, true).size(); } };
+struct SetSpeed { void operator()() const { gSink += ptu::Cmd::setDesiredSpeed(2000, ptu::PAN).size(); } };
+struct SetSpeedLimit { void operator()() const { gSink += ptu::Cmd::setSpeedLimit(4000, ptu::TILT, ptu::UPPER).size(); } };
+struct Halt { void operator()() const { gSink += ptu::Cmd::haltPosCmd(true, true).size(); } };
+
+struct QueryInt {
+    FramingProbe& probe;
+    std::string reply;
+    QueryInt(FramingProbe& probe) : probe(probe), reply("* -123456\r") {}
+    void operator()() const { gSink += probe.getQuery<int>(reply); }
+};
+
+struct QueryFloat {
+    FramingProbe& probe;
+    std::string reply;
+    QueryFloat(FramingProbe& probe) : probe(probe), reply("* 185.1428\r") {}
+    void operator()() const { gSink += long(probe.getQuery<float>(reply)); }
+};
+
+/** Points around an offset head, as a planner would score them. */
+struct LookAtPoints {
+    ptu::LookAt lookAt;
+    std::vector<base::Vector3d> points;
+
+    LookAtPoints() {
+        ptu::HeadModel model;
+        model.mounting.translate(base::Vector3d(0.3, -0.2, 1.1));
+        model.tiltOffset = base::Vector3d(0.02, 0.01, 0.08);
+        model.cameraOffset = base::Vector3d(0.05, 0.04, 0.06);
+        lookAt.setModel(model);
+        lookAt.setLimits(-2.7, 2.7, -0.8, 0.5);
+
+        for (int i = 0; i < 1000; ++i)
+            points.push_back(base::Vector3d(3 * std::cos(0.01 * i), 3 * std::sin(0.01 * i), 0.002 * i));
+    }
+};
+
+struct LookAtSingle {
+    const LookAtPoints& data;
+    mutable size_t next;
+    LookAtSingle(const LookAtPoints& data) : data(data), next(0) {}
+    void operator()() const {
+        ptu::PanTiltRad angles;
+        gSink += data.lookAt.solve(data.points[next], angles);
+        next = (next + 1) % data.points.size();
+    }
+};
+
+struct LookAtBatch {
+    const LookAtPoints& data;
+    mutable std::vector<ptu::PanTiltRad> angles;
+    mutable std::vector<unsigned char> reachable;
+    LookAtBatch(const LookAtPoints& data) : data(data) {}
+    void operator()() const { gSink += data.lookAt.solve(data.points, angles, reachable); }
+};
+
+//==============================================================================
+// Round trips over a pty
+//==============================================================================
+/**
+ * Answers every position query written to the slave side of a pty, like a
+ * unit that replies instantly. The latency measured is the host side only:
+ * tty layer, iodrivers_base and the driver.
+ */
+class PtyUnit {
+private:
+    int mMaster;
+    std::string mSlave;
+    boost::atomic<bool> mStop;
+    boost::thread mThread;
+
+    void serve() {
+        std::string pending;
+        char buffer[256];
+
+        while (!mStop.load()) {
+            pollfd fd = { mMaster, POLLIN, 0 };
+            if (poll(&fd, 1, 50) <= 0)
+                continue;
+
+            ssize_t size = read(mMaster, buffer, sizeof(buffer));
+            if (size <= 0)
+                continue;
+            pending.append(buffer, size);
+
+            // echoed replies never contain a query, so they are skipped
+            size_t query;
+            while ((query = pending.find("PP ")) != std::string::npos) {
+                pending.erase(0, query + 3);
+                if (write(mMaster, "* 123\r", 6) != 6)
+                    return;
+            }
+            if (pending.size() > 2)
+                pending.erase(0, pending.size() - 2);
+        }
+    }
+
+public:
+    PtyUnit() : mMaster(posix_openpt(O_RDWR | O_NOCTTY)), mStop(false) {
+        if (mMaster < 0 || grantpt(mMaster) != 0 || unlockpt(mMaster) != 0)
+            throw std::runtime_error("cannot create a pty");
+        mSlave = ptsname(mMaster);
+        mThread = boost::thread(&PtyUnit::serve, this);
+    }
+
+    ~PtyUnit() {
+        mStop.store(true);
+        mThread.join();
+        close(mMaster);
+    }
+
+    const std::string& getSlave() const { return mSlave; }
+};
+
+void roundTrips(size_t count) {
+    PtyUnit unit;
+    ptu::Driver driver;
+    if (!driver.openSerial(unit.getSlave(), 9600, true))
+        throw std::runtime_error("cannot open " + unit.getSlave());
+
+    // warm up
+    for (size_t i = 0; i < count / 10 + 1; ++i)
+        driver.getPos(ptu::PAN, false);
+
+    uint64_t total = 0, worst = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t start = ptu::TrafficLog::monotonicNs();
+        driver.getPos(ptu::PAN, false);
+        uint64_t elapsed = ptu::TrafficLog::monotonicNs() - start;
+        total += elapsed;
+        worst = std::max(worst, elapsed);
+    }
+
+    std::cout << std::left << std::setw(34) << "position query" << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1) << total / 1000.0 / count << " us/query"
+              << std::setw(10) << worst / 1000.0 << " us worst"
+              << "   in effect: " << ptu::SerialTuning::describe(driver.getSerialTuning()) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "show help")
+        ("iterations,n", po::value<size_t>()->default_value(200000), "iterations per benchmark")
+        ("pty", po::value<size_t>()->default_value(0), "position queries over a pty, 0 skips them");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    size_t n = vm["iterations"].as<size_t>();
+    FramingProbe probe;
+
+    // a burst of position and acknowledgement replies as seen while polling
+    std::string burst;
+    for (int i = 0; i < 64; ++i)
+        burst += i % 2 ? "*\r" : "* -12345\r";
+
+    std::cout << "Cmd encoding" << std::endl;
+    run("Cmd::getPos", GetPos(), n);
+    run("Cmd::setPos", SetPos(), n);
+    run("Cmd::setDesiredSpeed", SetSpeed(), n);
+    run("Cmd::setSpeedLimit", SetSpeedLimit(), n);
+    run("Cmd::haltPosCmd", Halt(), n);
+
+    std::cout << std::endl << "Framing (extractPacket)" << std::endl;
+    run("one reply", Framing(probe, "* -12345\r", 64), n);
+    run("one reply, 3 byte fragments", Framing(probe, "* -12345\r", 3), n);
+    run("one reply, 1 byte fragments", Framing(probe, "* -12345\r", 1), n);
+    run("noise then reply", Framing(probe, "\x13garbage\n* -12345\r", 64), n);
+    run("error reply", Framing(probe, "! Illegal command\r", 64), n);
+    run("burst of 64 replies", Framing(probe, burst, 512), n / 64 + 1);
+    run("burst of 64 replies, 16 byte reads", Framing(probe, burst, 16), n / 64 + 1);
+
+    std::cout << std::endl << "Parsing (getQuery)" << std::endl;
+    run("getQuery<int>", QueryInt(probe), n);
+    run("getQuery<float>", QueryFloat(probe), n);
+
+    // the batch reuses its output vectors, so it allocates nothing per point
+    LookAtPoints lookAt;
+    std::cout << std::endl << "Look-at (LookAt::solve)" << std::endl;
+    run("one point", LookAtSingle(lookAt), n);
+    run("batch of 1000 points", LookAtBatch(lookAt), n / 1000 + 1);
+
+    size_t queries = vm["pty"].as<size_t>();
+    if (queries > 0) {
+        std::cout << std::endl << "Round trips over a pty (Driver::getPos)" << std::endl;
+        roundTrips(queries);
+    }
+
+    return 0;
+}
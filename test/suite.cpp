@@ -0,0 +1,5 @@
+// \file suite.cpp
+// Entry point of the unit tests of the pure logic, which need no unit.
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
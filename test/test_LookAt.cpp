@@ -0,0 +1,121 @@
+// \file test_LookAt.cpp
+// Inverse and forward kinematics of the LookAt head model.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include <LookAt.h>
+
+using namespace ptu;
+
+namespace {
+
+/** A head mounted off the origin, turned and rolled, with all offsets set. */
+HeadModel offsetHead() {
+    HeadModel model;
+    model.mounting = base::Affine3d::Identity();
+    model.mounting.translate(base::Vector3d(0.3, -0.2, 1.1));
+    model.mounting.rotate(Eigen::AngleAxisd(0.4, base::Vector3d::UnitZ()));
+    model.mounting.rotate(Eigen::AngleAxisd(0.1, base::Vector3d::UnitX()));
+    model.tiltOffset = base::Vector3d(0.02, 0.01, 0.08);
+    model.cameraOffset = base::Vector3d(0.05, 0.04, 0.06);
+    return model;
+}
+
+/** Distance of \p point from the ray, and whether it lies ahead of it. */
+double missDistance(const base::Vector3d& point, const base::Vector3d& origin,
+                    const base::Vector3d& direction, bool& ahead) {
+    base::Vector3d v = point - origin;
+    ahead = v.dot(direction) > 0;
+    return (v - v.dot(direction) * direction).norm();
+}
+
+} /* namespace */
+
+BOOST_AUTO_TEST_SUITE(look_at)
+
+BOOST_AUTO_TEST_CASE(solve_then_ray_hits_the_point) {
+    LookAt lookAt(offsetHead());
+
+    size_t solved = 0;
+    for (int i = 0; i < 200; ++i) {
+        double azimuth = -2.5 + 5.0 * i / 200;
+        double elevation = -0.6 + 1.2 * ((i * 37) % 200) / 200.0;
+        double range = 0.5 + (i % 7);
+        base::Vector3d point(0.3 + range * std::cos(elevation) * std::cos(azimuth),
+                             -0.2 + range * std::cos(elevation) * std::sin(azimuth),
+                             1.1 + range * std::sin(elevation));
+
+        PanTiltRad angles;
+        if (!lookAt.solve(point, angles)) {
+            continue;
+        }
+        ++solved;
+
+        base::Vector3d origin, direction;
+        lookAt.ray(angles, origin, direction);
+
+        bool ahead;
+        BOOST_CHECK_SMALL(missDistance(point, origin, direction, ahead), 1e-9);
+        BOOST_CHECK(ahead);
+        BOOST_CHECK_CLOSE(direction.norm(), 1.0, 1e-9);
+    }
+    BOOST_CHECK_GT(solved, 190u);
+}
+
+BOOST_AUTO_TEST_CASE(ray_then_solve_gives_the_angles) {
+    LookAt lookAt(offsetHead());
+
+    for (double pan = -2.0; pan <= 2.0; pan += 0.37) {
+        for (double tilt = -0.7; tilt <= 0.5; tilt += 0.23) {
+            base::Vector3d origin, direction;
+            lookAt.ray(PanTiltRad(pan, tilt), origin, direction);
+
+            PanTiltRad angles;
+            BOOST_REQUIRE(lookAt.solve(origin + 3.0 * direction, angles));
+            BOOST_CHECK_SMALL(angles.pan - pan, 1e-9);
+            BOOST_CHECK_SMALL(angles.tilt - tilt, 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batch_matches_single_solutions) {
+    LookAt lookAt(offsetHead());
+    lookAt.setLimits(-1.5, 1.5, -0.5, 0.5);
+
+    std::vector<base::Vector3d> points;
+    for (int i = 0; i < 100; ++i) {
+        points.push_back(base::Vector3d(0.3 + 2 * std::cos(0.1 * i), -0.2 + 2 * std::sin(0.1 * i),
+                                        1.1 + 0.02 * (i - 50)));
+    }
+    points.push_back(base::Vector3d(0.3, -0.2, 1.1));   // on the pan axis
+
+    std::vector<PanTiltRad> angles;
+    std::vector<unsigned char> reachable;
+    size_t count = lookAt.solve(points, angles, reachable);
+
+    BOOST_REQUIRE_EQUAL(angles.size(), points.size());
+    BOOST_REQUIRE_EQUAL(reachable.size(), points.size());
+
+    size_t expected = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        PanTiltRad single;
+        bool ok = lookAt.solve(points[i], single);
+        BOOST_CHECK_EQUAL(bool(reachable[i]), ok);
+        if (ok) {
+            ++expected;
+            BOOST_CHECK_EQUAL(angles[i].pan, single.pan);
+            BOOST_CHECK_EQUAL(angles[i].tilt, single.tilt);
+            BOOST_CHECK(angles[i].pan >= -1.5 && angles[i].pan <= 1.5);
+            BOOST_CHECK(angles[i].tilt >= -0.5 && angles[i].tilt <= 0.5);
+        }
+    }
+    BOOST_CHECK_EQUAL(count, expected);
+    BOOST_CHECK(!reachable.back());
+    BOOST_CHECK_GT(count, 0u);
+    BOOST_CHECK_LT(count, points.size() - 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
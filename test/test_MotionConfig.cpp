@@ -0,0 +1,139 @@
+// \file test_MotionConfig.cpp
+// Command ordering and scaling of the motion configurations.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <MotionConfig.h>
+
+using namespace ptu;
+
+namespace {
+
+/**
+ * Applies \p commands to \p config like the unit would, checking after each
+ * one that the unit accepts the intermediate state: the desired speed
+ * within the speed limits and not below the base speed. In pure velocity
+ * mode, where the desired speed moves the head, only the speed of \p target
+ * may be sent.
+ */
+void apply(MotionConfig& config, const std::vector<std::string>& commands, const MotionConfig& target) {
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const std::string& cmd = commands[i];
+        BOOST_REQUIRE_GE(cmd.size(), 2u);
+
+        if (cmd[0] == 'C') {
+            config.ctrlMode = cmd[1] == 'V' ? PURE : INDEP;
+            continue;
+        }
+
+        Axis name = cmd[0] == 'T' ? TILT : PAN;
+        AxisConfig& axis = config.axis(name);
+        int value = atoi(cmd.c_str() + 2);
+        switch (cmd[1]) {
+            case 'S':
+                BOOST_CHECK_MESSAGE(config.ctrlMode == INDEP || value == target.axis(name).speed,
+                                    cmd << " sent in pure velocity mode");
+                axis.speed = value;
+                break;
+            case 'A': axis.accel = value; break;
+            case 'B': axis.baseSpeed = value; break;
+            case 'U': axis.upperSpeedLimit = value; break;
+            case 'L': axis.lowerSpeedLimit = value; break;
+            default: BOOST_FAIL("unexpected command " + cmd);
+        }
+
+        BOOST_CHECK_MESSAGE(axis.speed <= axis.upperSpeedLimit && axis.speed >= axis.lowerSpeedLimit,
+                            "speed outside the limits after " << cmd);
+        BOOST_CHECK_MESSAGE(axis.baseSpeed <= axis.speed, "base speed above the speed after " << cmd);
+    }
+}
+
+void checkTransition(const MotionConfig& from, const MotionConfig& to) {
+    MotionConfig unit = from;
+    apply(unit, to.commandsFrom(from), to);
+    BOOST_CHECK(unit == to);
+}
+
+} /* namespace */
+
+BOOST_AUTO_TEST_SUITE(motion_config)
+
+BOOST_AUTO_TEST_CASE(unchanged_config_sends_nothing) {
+    MotionConfig config;
+    BOOST_CHECK(config.commandsFrom(config).empty());
+}
+
+BOOST_AUTO_TEST_CASE(only_changed_settings_are_sent) {
+    MotionConfig from, to;
+    to.tilt.accel = 3000;
+
+    std::vector<std::string> commands = to.commandsFrom(from);
+    BOOST_REQUIRE_EQUAL(commands.size(), 1u);
+    BOOST_CHECK_EQUAL(commands[0], Cmd::setDesiredAccel(3000, TILT));
+}
+
+BOOST_AUTO_TEST_CASE(limits_widen_before_speeds_rise) {
+    MotionConfig slow, fast;
+    slow.pan = AxisConfig(500, 1000, 100, 1000, 50);
+    fast.pan = AxisConfig(3000, 4000, 800, 4000, 600);
+
+    std::vector<std::string> commands = fast.commandsFrom(slow);
+    BOOST_REQUIRE(!commands.empty());
+    BOOST_CHECK_EQUAL(commands.front(), Cmd::setSpeedLimit(4000, PAN, UPPER));
+    BOOST_CHECK_EQUAL(commands.back(), Cmd::setSpeedLimit(600, PAN, LOWER));
+
+    checkTransition(slow, fast);
+}
+
+BOOST_AUTO_TEST_CASE(limits_narrow_after_speeds_fall) {
+    MotionConfig slow, fast;
+    slow.pan = AxisConfig(500, 1000, 100, 1000, 50);
+    fast.pan = AxisConfig(3000, 4000, 800, 4000, 600);
+
+    std::vector<std::string> commands = slow.commandsFrom(fast);
+    BOOST_REQUIRE(!commands.empty());
+    BOOST_CHECK_EQUAL(commands.front(), Cmd::setSpeedLimit(50, PAN, LOWER));
+    BOOST_CHECK_EQUAL(commands.back(), Cmd::setSpeedLimit(1000, PAN, UPPER));
+
+    checkTransition(fast, slow);
+}
+
+BOOST_AUTO_TEST_CASE(every_transition_is_accepted) {
+    std::vector<AxisConfig> axes;
+    axes.push_back(AxisConfig(500, 1000, 100, 1000, 50));
+    axes.push_back(AxisConfig(3000, 4000, 800, 4000, 600));
+    axes.push_back(AxisConfig(1200, 2000, 1100, 2000, 1000));
+    axes.push_back(AxisConfig(900, 500, 0, 900, 0));
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        for (size_t j = 0; j < axes.size(); ++j) {
+            for (int mode = 0; mode < 4; ++mode) {
+                MotionConfig from, to;
+                from.pan = axes[i];
+                from.tilt = axes[j];
+                from.ctrlMode = mode & 1 ? PURE : INDEP;
+                to.pan = axes[j];
+                to.tilt = axes[i];
+                to.ctrlMode = mode & 2 ? PURE : INDEP;
+
+                checkTransition(from, to);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(scaling_rounds_every_setting) {
+    AxisConfig config(1000, 2001, 150, 2000, 3);
+    AxisConfig finer = config.scaled(4);
+    AxisConfig coarser = config.scaled(0.25);
+
+    BOOST_CHECK(finer == AxisConfig(4000, 8004, 600, 8000, 12));
+    BOOST_CHECK(coarser == AxisConfig(250, 500, 38, 500, 1));
+    BOOST_CHECK(config.scaled(1) == config);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+// \file test_MotionGuard.cpp
+// Zone geometry and routing of the MotionGuard.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <MotionGuard.h>
+
+using namespace ptu;
+
+namespace {
+
+/** The square [-half, half] x [-half, half], counterclockwise unless \p clockwise. */
+MotionGuard::Polygon square(double half, bool clockwise = false) {
+    MotionGuard::Polygon polygon;
+    polygon.push_back(PanTiltRad(-half, -half));
+    polygon.push_back(PanTiltRad(half, -half));
+    polygon.push_back(PanTiltRad(half, half));
+    polygon.push_back(PanTiltRad(-half, half));
+    if (clockwise) {
+        std::reverse(polygon.begin(), polygon.end());
+    }
+    return polygon;
+}
+
+const Units units(0.05, 0.05);
+
+PanTiltTicks ticks(double pan, double tilt) {
+    return units.toTicks(PanTiltRad(pan, tilt));
+}
+
+} /* namespace */
+
+BOOST_AUTO_TEST_SUITE(motion_guard)
+
+BOOST_AUTO_TEST_CASE(zone_needs_three_vertices) {
+    MotionGuard guard;
+    MotionGuard::Polygon polygon = square(0.1);
+    polygon.resize(2);
+
+    BOOST_CHECK_THROW(guard.addZone(polygon), std::runtime_error);
+    BOOST_CHECK_EQUAL(guard.getZoneCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(finds_points_in_concave_zone) {
+    MotionGuard::Polygon l;
+    l.push_back(PanTiltRad(0, 0));
+    l.push_back(PanTiltRad(0.2, 0));
+    l.push_back(PanTiltRad(0.2, 0.1));
+    l.push_back(PanTiltRad(0.1, 0.1));
+    l.push_back(PanTiltRad(0.1, 0.2));
+    l.push_back(PanTiltRad(0, 0.2));
+
+    MotionGuard guard;
+    guard.addZone(square(0.1));
+    guard.addZone(l);
+
+    BOOST_CHECK_EQUAL(guard.zoneAt(PanTiltRad(0.15, 0.05)), 1);
+    BOOST_CHECK_EQUAL(guard.zoneAt(PanTiltRad(0.05, 0.15)), 1);
+    BOOST_CHECK_EQUAL(guard.zoneAt(PanTiltRad(0.15, 0.15)), -1);    // in the notch
+    BOOST_CHECK_EQUAL(guard.zoneAt(PanTiltRad(0.3, 0.05)), -1);
+    BOOST_CHECK_EQUAL(guard.zoneAt(PanTiltRad(-0.05, -0.05)), 0);
+}
+
+BOOST_AUTO_TEST_CASE(targets_keep_half_the_clearance) {
+    for (int clockwise = 0; clockwise < 2; ++clockwise) {
+        MotionGuard guard(0.02);
+        guard.addZone(square(0.1, clockwise));
+
+        BOOST_CHECK_THROW(guard.validate(PanTiltRad(0, 0)), std::runtime_error);
+        BOOST_CHECK_THROW(guard.validate(PanTiltRad(0.105, 0)), std::runtime_error);
+        BOOST_CHECK_THROW(guard.validate(PanTiltRad(0, -0.105)), std::runtime_error);
+        BOOST_CHECK_THROW(guard.validate(PanTiltRad(0.108, 0.108)), std::runtime_error);
+        BOOST_CHECK_NO_THROW(guard.validate(PanTiltRad(0.115, 0)));
+        BOOST_CHECK_NO_THROW(guard.validate(PanTiltRad(-0.115, 0.05)));
+
+        // continuous pan checks the tilt limits only
+        BOOST_CHECK_NO_THROW(guard.validate(PanTiltRad(0, 0), false));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(moves_through_zone_are_not_clear) {
+    MotionGuard guard(0.02);
+    guard.addZone(square(0.1));
+    MovePredictor predictor;
+
+    BOOST_CHECK(!guard.isClear(ticks(-0.3, 0), ticks(0.3, 0), units, predictor));
+    BOOST_CHECK(!guard.isClear(ticks(0, -0.3), ticks(0, 0.3), units, predictor));
+    BOOST_CHECK(!guard.isClear(ticks(-0.3, -0.3), ticks(0.3, 0.3), units, predictor));
+    BOOST_CHECK(guard.isClear(ticks(-0.3, 0.15), ticks(0.3, 0.15), units, predictor));
+    BOOST_CHECK(guard.isClear(ticks(0.2, -0.3), ticks(0.2, 0.3), units, predictor));
+
+    // a head caught in the zone may leave it
+    BOOST_CHECK(guard.isClear(ticks(0, 0), ticks(0.3, 0), units, predictor));
+}
+
+BOOST_AUTO_TEST_CASE(routes_around_zone) {
+    MotionGuard guard(0.02);
+    guard.addZone(square(0.1));
+    MovePredictor predictor;
+
+    PanTiltTicks from = ticks(-0.15, 0.08);
+    PanTiltTicks to = ticks(0.15, 0.08);
+    double duration = 0;
+    std::vector<PanTiltTicks> waypoints = guard.route(from, to, units, predictor, &duration);
+
+    BOOST_REQUIRE_GE(waypoints.size(), 2u);
+    BOOST_CHECK_EQUAL(waypoints.back().pan, to.pan);
+    BOOST_CHECK_EQUAL(waypoints.back().tilt, to.tilt);
+    BOOST_CHECK_GT(duration, predictor.duration(from, to));
+
+    PanTiltTicks prev = from;
+    for (size_t i = 0; i < waypoints.size(); ++i) {
+        BOOST_CHECK(guard.isClear(prev, waypoints[i], units, predictor));
+        // over the zone, tilt hardly moves
+        BOOST_CHECK_GT(waypoints[i].tilt, 0);
+        prev = waypoints[i];
+    }
+}
+
+BOOST_AUTO_TEST_CASE(clear_move_needs_no_waypoints) {
+    MotionGuard guard(0.02);
+    guard.addZone(square(0.1));
+    MovePredictor predictor;
+
+    std::vector<PanTiltTicks> waypoints = guard.route(ticks(-0.3, 0.2), ticks(0.3, 0.2), units, predictor);
+
+    BOOST_REQUIRE_EQUAL(waypoints.size(), 1u);
+    BOOST_CHECK_EQUAL(waypoints[0].pan, ticks(0.3, 0.2).pan);
+}
+
+BOOST_AUTO_TEST_CASE(blocked_route_throws) {
+    MotionGuard::Polygon wall;
+    wall.push_back(PanTiltRad(-0.1, -0.5));
+    wall.push_back(PanTiltRad(0.1, -0.5));
+    wall.push_back(PanTiltRad(0.1, 0.5));
+    wall.push_back(PanTiltRad(-0.1, 0.5));
+
+    MotionGuard guard(0.02);
+    guard.setLimits(TILT, -0.3, 0.3);
+    guard.addZone(wall);
+    MovePredictor predictor;
+
+    BOOST_CHECK_THROW(guard.route(ticks(-0.3, 0), ticks(0.3, 0), units, predictor), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
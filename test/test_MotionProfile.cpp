@@ -0,0 +1,72 @@
+// \file test_MotionProfile.cpp
+// Profile selection of the ProfileTuner.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+
+#include <MotionProfile.h>
+
+using namespace ptu;
+
+BOOST_AUTO_TEST_SUITE(motion_profile)
+
+BOOST_AUTO_TEST_CASE(stall_speed_below_max_speed) {
+    AxisCapability pan(2000, 1500, 3000, 100);
+    ProfileTuner tuner(pan, pan, 0.2);
+
+    int distances[] = { 10, 200, 2000, 20000 };
+    for (int i = 0; i < 4; ++i) {
+        AxisMotion motion = tuner.select(PAN, distances[i]);
+
+        BOOST_CHECK_GT(motion.accel, 0);
+        BOOST_CHECK_LT(motion.speed, pan.stallSpeed);
+        BOOST_CHECK_LE(motion.accel, pan.accelAt(motion.speed) * 0.8 + 1);
+        BOOST_CHECK_LE(motion.baseSpeed, motion.speed);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(long_moves_trade_accel_for_speed) {
+    AxisCapability pan(4000, 3000, 3000, 100);
+    ProfileTuner tuner(pan, pan, 0);
+
+    AxisMotion hop = tuner.select(PAN, 50);
+    AxisMotion slew = tuner.select(PAN, 50000);
+
+    BOOST_CHECK_GT(hop.accel, slew.accel);
+    BOOST_CHECK_GT(slew.speed, hop.speed);
+}
+
+BOOST_AUTO_TEST_CASE(no_acceleration_left_throws) {
+    // stalls below the base speed, no speed leaves torque to accelerate
+    AxisCapability pan(2000, 50, 3000, 100);
+    ProfileTuner tuner(pan, pan, 0);
+
+    BOOST_CHECK_THROW(tuner.select(PAN, 1000), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_current_profile_within_hysteresis) {
+    AxisCapability pan(2000, 0, 2000, 100);
+    ProfileTuner tuner(pan, pan, 0.2);
+    tuner.setHysteresis(0.5);
+
+    AxisMotion best = tuner.select(PAN, 5000);
+    AxisMotion close(best.speed * 0.9, best.accel, best.baseSpeed);
+    AxisMotion unsafe(best.speed * 2, best.accel, best.baseSpeed);
+
+    AxisMotion kept = tuner.select(PAN, 5000, close);
+    BOOST_CHECK_EQUAL(kept.speed, close.speed);
+
+    AxisMotion replaced = tuner.select(PAN, 5000, unsafe);
+    BOOST_CHECK_EQUAL(replaced.speed, best.speed);
+}
+
+BOOST_AUTO_TEST_CASE(stall_margin_range) {
+    ProfileTuner tuner((AxisCapability()), AxisCapability());
+
+    BOOST_CHECK_THROW(tuner.setStallMargin(-0.1), std::runtime_error);
+    BOOST_CHECK_THROW(tuner.setStallMargin(1), std::runtime_error);
+    BOOST_CHECK_NO_THROW(tuner.setStallMargin(0.5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+// \file test_MovePredictor.cpp
+// Calibration of the MovePredictor against observed move times.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <MovePredictor.h>
+
+using namespace ptu;
+
+BOOST_AUTO_TEST_SUITE(move_predictor)
+
+BOOST_AUTO_TEST_CASE(uncalibrated_follows_the_model) {
+    MotionModel model(AxisMotion(1000, 2000, 100), AxisMotion(500, 1000, 50));
+    MovePredictor predictor(model);
+
+    BOOST_CHECK_EQUAL(predictor.duration(PAN, 0), 0);
+    BOOST_CHECK_CLOSE(predictor.duration(PAN, 3000), MotionModel::moveTime(model.axis(PAN), 3000), 1e-9);
+    BOOST_CHECK_CLOSE(predictor.duration(PanTiltTicks(0, 0), PanTiltTicks(100, 2000)),
+                      MotionModel::moveTime(model.axis(TILT), 2000), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(calibration_converges) {
+    MotionModel model;
+    MovePredictor predictor(model);
+
+    // the unit takes 20% longer than modeled plus 30ms of latency
+    for (int i = 0; i < 100; ++i) {
+        int distance = 100 + (i * 397) % 5000;
+        predictor.observe(PAN, distance, 1.2 * MotionModel::moveTime(model.axis(PAN), distance) + 0.03);
+    }
+
+    BOOST_CHECK_CLOSE(predictor.getScale(PAN), 1.2, 1e-3);
+    BOOST_CHECK_CLOSE(predictor.getOffset(PAN), 0.03, 1e-2);
+    BOOST_CHECK_CLOSE(predictor.duration(PAN, 2500), 1.2 * MotionModel::moveTime(model.axis(PAN), 2500) + 0.03, 1e-3);
+
+    // the other axis is untouched
+    BOOST_CHECK_EQUAL(predictor.getScale(TILT), 1);
+    BOOST_CHECK_EQUAL(predictor.getOffset(TILT), 0);
+}
+
+BOOST_AUTO_TEST_CASE(calibration_follows_drift) {
+    MotionModel model;
+    MovePredictor predictor(model, 0.9);
+
+    for (int i = 0; i < 200; ++i) {
+        int distance = 100 + (i * 397) % 5000;
+        double scale = i < 100 ? 1.0 : 1.5;
+        predictor.observe(TILT, distance, scale * MotionModel::moveTime(model.axis(TILT), distance));
+    }
+
+    BOOST_CHECK_CLOSE(predictor.getScale(TILT), 1.5, 1e-2);
+}
+
+BOOST_AUTO_TEST_CASE(negative_offset_keeps_durations_positive) {
+    MotionModel model;
+    MovePredictor predictor(model);
+
+    // faster than modeled by a constant: short moves would get negative times
+    for (int i = 0; i < 50; ++i) {
+        int distance = 1000 + (i * 397) % 5000;
+        predictor.observe(PAN, distance, MotionModel::moveTime(model.axis(PAN), distance) - 0.2);
+    }
+    BOOST_REQUIRE_LT(predictor.getOffset(PAN), 0);
+
+    for (int distance = 1; distance <= 2000; distance *= 2) {
+        BOOST_CHECK_GT(predictor.duration(PAN, distance), 0);
+        BOOST_CHECK_GT(predictor.duration(PAN, -distance), 0);
+    }
+    BOOST_CHECK_CLOSE(predictor.duration(PAN, 4000), MotionModel::moveTime(model.axis(PAN), 4000) - 0.2, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(reset_drops_the_calibration) {
+    MotionModel model;
+    MovePredictor predictor(model);
+    for (int i = 0; i < 10; ++i) {
+        predictor.observe(PAN, 500 + 100 * i, 2 * MotionModel::moveTime(model.axis(PAN), 500 + 100 * i));
+    }
+
+    predictor.resetCalibration();
+    BOOST_CHECK_EQUAL(predictor.getScale(PAN), 1);
+    BOOST_CHECK_EQUAL(predictor.getOffset(PAN), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+// \file test_ScanPlanner.cpp
+// Visiting orders of the ScanPlanner.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <ScanPlanner.h>
+
+using namespace ptu;
+
+namespace {
+
+/** Deterministic pseudo random positions in [-range, range]. */
+class Positions {
+    unsigned mState;
+
+public:
+    explicit Positions(unsigned seed) : mState(seed) {}
+
+    int next(int range) {
+        mState = mState * 1103515245u + 12345u;
+        return int((mState >> 8) % unsigned(2 * range + 1)) - range;
+    }
+};
+
+} /* namespace */
+
+BOOST_AUTO_TEST_SUITE(scan_planner)
+
+BOOST_AUTO_TEST_CASE(two_opt_never_worse_than_nearest_neighbour) {
+    MotionModel model(AxisMotion(2000, 4000, 100), AxisMotion(1000, 3000, 100));
+    ScanPlanner greedy(model, 0);
+    ScanPlanner planner(model);
+    Positions random(42);
+
+    for (int trial = 0; trial < 50; ++trial) {
+        PanTiltTicks start(random.next(3000), random.next(1000));
+        std::vector<PanTiltTicks> viewpoints(5 + trial % 20);
+        for (size_t i = 0; i < viewpoints.size(); ++i) {
+            viewpoints[i] = PanTiltTicks(random.next(3000), random.next(1000));
+        }
+
+        double greedyTime, time;
+        greedy.plan(start, viewpoints, &greedyTime);
+        std::vector<size_t> order = planner.plan(start, viewpoints, &time);
+
+        BOOST_CHECK_LE(time, greedyTime + 1e-9);
+        BOOST_CHECK_CLOSE(time, planner.duration(start, viewpoints, order), 1e-6);
+
+        // a permutation of the viewpoints
+        std::sort(order.begin(), order.end());
+        BOOST_REQUIRE_EQUAL(order.size(), viewpoints.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            BOOST_CHECK_EQUAL(order[i], i);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(untangles_crossing_path) {
+    MotionModel model;
+    ScanPlanner planner(model);
+
+    // the greedy tour from 0 goes to 100 first and has to come back past 0
+    std::vector<PanTiltTicks> viewpoints;
+    viewpoints.push_back(PanTiltTicks(100, 0));
+    viewpoints.push_back(PanTiltTicks(-150, 0));
+    viewpoints.push_back(PanTiltTicks(-3000, 0));
+    viewpoints.push_back(PanTiltTicks(3000, 0));
+
+    double time;
+    planner.plan(PanTiltTicks(0, 0), viewpoints, &time);
+
+    double greedyTime;
+    ScanPlanner(model, 0).plan(PanTiltTicks(0, 0), viewpoints, &greedyTime);
+    BOOST_CHECK_LT(time, greedyTime);
+}
+
+BOOST_AUTO_TEST_CASE(empty_scan) {
+    ScanPlanner planner((MotionModel()));
+    double time = -1;
+
+    BOOST_CHECK(planner.plan(PanTiltTicks(), std::vector<PanTiltTicks>(), &time).empty());
+    BOOST_CHECK_EQUAL(time, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
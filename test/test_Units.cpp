@@ -0,0 +1,84 @@
+// \file test_Units.cpp
+// Rounding and batch conversions of the unit conversion layer.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <Units.h>
+
+using namespace ptu;
+
+BOOST_AUTO_TEST_SUITE(units)
+
+BOOST_AUTO_TEST_CASE(rounds_to_nearest_tick) {
+    AxisUnits axis(0.05);
+
+    BOOST_CHECK_EQUAL(axis.degToTicks(0.024), 0);
+    BOOST_CHECK_EQUAL(axis.degToTicks(0.026), 1);
+    BOOST_CHECK_EQUAL(axis.degToTicks(-0.024), 0);
+    BOOST_CHECK_EQUAL(axis.degToTicks(-0.026), -1);
+    BOOST_CHECK_EQUAL(axis.degToTicks(90), 1800);
+    BOOST_CHECK_EQUAL(axis.degToTicks(-90), -1800);
+    BOOST_CHECK_EQUAL(axis.radToTicks(M_PI / 2), 1800);
+    BOOST_CHECK_EQUAL(axis.radPerSecToTicks(-M_PI / 2), -1800);
+}
+
+BOOST_AUTO_TEST_CASE(round_trip_within_half_a_tick) {
+    AxisUnits axis(0.0514286);  // a typical PTU resolution, 185.1428 arc seconds
+    double halfTick = axis.ticksToRad(1) / 2;
+
+    for (double rad = -3.0; rad <= 3.0; rad += 0.0123) {
+        BOOST_CHECK_LE(std::fabs(axis.ticksToRad(axis.radToTicks(rad)) - rad), halfTick + 1e-12);
+    }
+    for (int ticks = -3000; ticks <= 3000; ticks += 7) {
+        BOOST_CHECK_EQUAL(axis.radToTicks(axis.ticksToRad(ticks)), ticks);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batch_matches_scalar) {
+    Units units(0.05, 0.0125);
+
+    std::vector<double> rad;
+    for (double r = -1.0; r <= 1.0; r += 0.0371) {
+        rad.push_back(r);
+    }
+    std::vector<int> ticks;
+    units.axis(TILT).radToTicks(rad, ticks);
+    BOOST_REQUIRE_EQUAL(ticks.size(), rad.size());
+    for (size_t i = 0; i < rad.size(); ++i) {
+        BOOST_CHECK_EQUAL(ticks[i], units.axis(TILT).radToTicks(rad[i]));
+    }
+
+    std::vector<double> back;
+    units.axis(TILT).ticksToRad(ticks, back);
+    BOOST_REQUIRE_EQUAL(back.size(), ticks.size());
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        BOOST_CHECK_EQUAL(back[i], units.axis(TILT).ticksToRad(ticks[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(grid_spans_the_corners) {
+    Units units(0.05, 0.0125);
+    std::vector<PanTiltTicks> grid;
+    units.grid(-0.5, 0.5, 3, -0.2, 0.2, 2, grid);
+
+    BOOST_REQUIRE_EQUAL(grid.size(), 6u);
+    BOOST_CHECK_EQUAL(grid.front().pan, units.axis(PAN).radToTicks(-0.5));
+    BOOST_CHECK_EQUAL(grid.front().tilt, units.axis(TILT).radToTicks(-0.2));
+    BOOST_CHECK_EQUAL(grid.back().pan, units.axis(PAN).radToTicks(0.5));
+    BOOST_CHECK_EQUAL(grid.back().tilt, units.axis(TILT).radToTicks(0.2));
+}
+
+BOOST_AUTO_TEST_CASE(resolution_must_be_positive) {
+    AxisUnits axis;
+    BOOST_CHECK_THROW(axis.setResolutionDeg(0), std::runtime_error);
+    BOOST_CHECK_THROW(axis.setResolutionDeg(-0.05), std::runtime_error);
+
+    axis.setResolutionDeg(0.025);
+    BOOST_CHECK_EQUAL(axis.degToTicks(1), 40);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
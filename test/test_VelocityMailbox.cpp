@@ -0,0 +1,99 @@
+// \file test_VelocityMailbox.cpp
+// Latest-wins semantics and wakeups of the VelocityMailbox.
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include <VelocityMailbox.h>
+
+using namespace ptu;
+
+BOOST_AUTO_TEST_SUITE(velocity_mailbox)
+
+BOOST_AUTO_TEST_CASE(newest_setpoint_wins) {
+    VelocityMailbox mailbox;
+    int speed = 0;
+
+    BOOST_CHECK(!mailbox.take(PAN, speed));
+
+    mailbox.post(PAN, 100);
+    mailbox.post(PAN, -200);
+    mailbox.post(TILT, 300);
+
+    BOOST_REQUIRE(mailbox.take(PAN, speed));
+    BOOST_CHECK_EQUAL(speed, -200);
+    BOOST_CHECK(!mailbox.take(PAN, speed));
+
+    BOOST_REQUIRE(mailbox.take(TILT, speed));
+    BOOST_CHECK_EQUAL(speed, 300);
+
+    BOOST_CHECK_EQUAL(mailbox.getPostedCount(), 3u);
+    BOOST_CHECK_EQUAL(mailbox.getDroppedCount(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(retry_returns_the_newest_setpoint_again) {
+    VelocityMailbox mailbox;
+    int speed = 0;
+
+    mailbox.post(TILT, 10);
+    BOOST_REQUIRE(mailbox.take(TILT, speed));
+    mailbox.retry(TILT);
+
+    BOOST_REQUIRE(mailbox.take(TILT, speed));
+    BOOST_CHECK_EQUAL(speed, 10);
+    BOOST_CHECK_EQUAL(mailbox.getDroppedCount(), 0u);
+
+    // a newer setpoint supersedes the failed one
+    mailbox.retry(TILT);
+    mailbox.post(TILT, 20);
+    BOOST_REQUIRE(mailbox.take(TILT, speed));
+    BOOST_CHECK_EQUAL(speed, 20);
+    BOOST_CHECK_EQUAL(mailbox.getDroppedCount(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(wait_times_out_without_posts) {
+    VelocityMailbox mailbox;
+    BOOST_CHECK(!mailbox.wait(base::Time::fromMilliseconds(10)));
+
+    mailbox.post(PAN, 1);
+    BOOST_CHECK(mailbox.wait(base::Time::fromMilliseconds(10)));
+}
+
+namespace {
+
+void produce(VelocityMailbox* mailbox, int count) {
+    for (int i = 1; i < count; ++i) {
+        mailbox->post(PAN, i);
+        if (i % 64 == 0)
+            boost::this_thread::yield();
+    }
+    mailbox->post(PAN, 0);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(final_setpoint_is_never_left_behind) {
+    // a lost wakeup would leave the final zero speed in the slot until the
+    // wait below times out
+    for (int round = 0; round < 200; ++round) {
+        VelocityMailbox mailbox;
+        boost::thread producer(produce, &mailbox, 2000);
+
+        int speed = -1;
+        bool stopped = false;
+        while (!stopped) {
+            if (!mailbox.wait(base::Time::fromSeconds(2)))
+                break;
+            while (mailbox.take(PAN, speed)) {
+                mailbox.markSent();
+                stopped = speed == 0;
+            }
+        }
+        producer.join();
+
+        BOOST_REQUIRE_MESSAGE(stopped, "round " << round << ": last speed taken " << speed);
+        BOOST_CHECK_EQUAL(mailbox.getSentCount() + mailbox.getDroppedCount(), mailbox.getPostedCount());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
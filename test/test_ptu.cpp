@@ -15,15 +15,38 @@ int main(int argc, char* argv[]) {
     desc.add_options()
         ("help", "show help")
         ("port,p", "port to connect to (by default it connects to localhost")
-        ("query,q", "queries the properties of the ptu"); 
-
+        ("query,q", "queries the properties of the ptu")
+        ("record", po::value<std::string>(), "records the raw traffic into the given log")
+        ("replay", po::value<std::string>(), "runs against a recorded log instead of the device")
+        ("fast", "replays the log as fast as possible"); 
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    // replies are awaited per command (see Driver::getQueryDeadline), the
+    // global read timeout is not used
     ptu::Driver drv;
-    base::Time tout = base::Time::fromSeconds(2.0);
-    drv.setReadTimeout(tout);
-    drv.setWriteTimeout(tout);
-    drv.openSerial("/dev/ttyS1", 9600);
+    drv.setWriteTimeout(base::Time::fromSeconds(2.0));
+    if (vm.count("replay")) {
+        drv.openReplay(vm["replay"].as<std::string>(),
+                vm.count("fast") ? ptu::REPLAY_FAST : ptu::REPLAY_REALTIME);
+    } else {
+        drv.openSerial("/dev/ttyS1", 9600);
+    }
+    if (vm.count("record"))
+        drv.startRecording(vm["record"].as<std::string>());
     drv.initialize();
 
+    std::cout << "Deadline of a position query: "
+              << drv.getQueryDeadline(ptu::Cmd::getPos(ptu::PAN).size()).toMilliseconds() << " ms"
+              << std::endl << std::endl;
+
     int int_answer = 0;
     float float_answer = 0;
 